@@ -8,13 +8,23 @@
 // There is an edge connecting two nodes if those nodes are neighbor positions in the board. 
 // There are 4 extra virtual nodes (WEST, EAST, NORTH and SOUTH) connected to nodes of the start and end positions in the board.
 // WEST and EAST start 'O'. NORTH and SOUTH start 'X'.
-// At each move, the selected position is marked with the player's sign and assigned edges that correspond to said position
+// Since the edges of a hex board never change, they are precomputed once per board size in a neighbor table
+// shared by every graph. At each move, the selected position is only marked with the player's sign.
 // If start virtual node and end virtual node are in the same path, then there is a winner.
+// The graph also keeps one stone mask per player, and the winner is found with a flood fill over the mask
+// (hex-neighbor shifts and ANDs) instead of a BFS over the nodes.
+// The board code (Graph, Evaluate, hexGame) is a template on the board size N, compiled once for every size
+// the game supports, so neighbor math, border masks and index types are fixed at compile time.
+// The graph also keeps a disjoint-set forest joining neighbor stones of the same sign, with the virtual nodes as
+// permanent members, so whether a player has connected both borders is known after every move with a lookup.
+// Moves are played on the graph with play and taken back with undo, which rolls back the forest from a small undo stack.
+// The simulations work on a single copy of the board and undo their moves instead of copying the graph every time.
 
 // AI plays using Monte Carlo simulations to make the best move at each round.
-// To implement a best move for AI, every available position in the board is evaluated to check what is the best next move. 
-// A win probability (probability of win in a set of >= 1000 random simulations) is calculated and the position with
-// higher probability is chosen.
+// By default the move is chosen with Monte Carlo tree search (UCT): the simulations grow a tree of the most promising
+// lines of play, and the most visited move at the root is played.
+// With --search=flat, every available position in the board is evaluated instead: a win probability (probability of
+// win in a set of up to 1000 random simulations) is calculated and the position with higher probability is chosen.
 // To optimize the probability calculation, a simulation is interrupted before its end if that position can't beat the best current
 // probability anymore. 
 // Many internal structures of the graph were modified to optimize Monte Carlo evaluation, resulting in significant
@@ -27,24 +37,78 @@
 #include <iostream>
 #include <iomanip> 
 #include <climits>
+#include <cmath>
 #include <vector>
-#include <list>
 #include <random>
 #include <algorithm>
+#include <numeric>
 #include <ctime>
 #include <string>
 #include <chrono>
 #include <tuple>
 #include <thread>
+#include <atomic>
+#include <cstdint>
+#include <array>
+#include <type_traits>
+#include <utility>
+#include <bitset>
+#include <functional>
+#include <stdexcept>
+#if defined(__AVX2__) || defined(__BMI2__)
+#include <immintrin.h>
+#endif
 using namespace std;
 
-const int INFINIT = INT_MAX;
-static int sizeofBoard = 0;
 // SIMUL set the default number of simulations for each Monte Carlo move evaluation  
 const int SIMUL = 1000;
+// Range of board sizes the game can be played on. The board code is compiled once for each size.
+const int MINBOARD = 2;
+const int MAXBOARD = 25;
+
+// How a Monte Carlo simulation is played out after the candidate move.
+// FILL_BOARD fills every empty cell and checks the full board once at the end.
+// EARLY_STOP reads the graph's connectivity after each move and stops as soon as either player connects.
+// RANDOM_COLORING samples the final coloring of a filled board directly as stone masks, without playing any move.
+enum PlayoutMode { FILL_BOARD, EARLY_STOP, RANDOM_COLORING };
+
+// How the AI chooses its move.
+// TREE_SEARCH runs Monte Carlo tree search (UCT): the simulations grow a tree of the most promising lines of play.
+// FLAT_MC runs the same number of simulations for every candidate move and picks the best win rate.
+enum SearchMode { TREE_SEARCH, FLAT_MC };
+
+// How flat Monte Carlo spends its simulations over the candidate moves.
+// ORDERED_PRUNING evaluates the candidates one after another, stopping a candidate once it can't beat the best so far.
+// SUCCESSIVE_HALVING runs rounds in which every remaining candidate gets the same number of simulations, and drops
+// the worse half of them after each round.
+enum RootSchedule { ORDERED_PRUNING, SUCCESSIVE_HALVING };
+
+// When ordered pruning stops evaluating a candidate.
+// EXACT_BOUND stops once the candidate can't beat the best so far even by winning all of its remaining simulations.
+// CONFIDENCE_BOUND also stops once a Hoeffding bound says the candidate is unlikely to beat it, with a set error rate.
+enum PruneRule { EXACT_BOUND, CONFIDENCE_BOUND };
+
+// Settings of the AI, chosen on the command line
+struct SearchOptions {
+	SearchMode search = TREE_SEARCH;	// How the move is chosen
+	PlayoutMode playout = FILL_BOARD;	// How each simulation is played out
+	RootSchedule schedule = ORDERED_PRUNING;	// How flat Monte Carlo spreads the simulations over the candidates
+	bool seeded = false;	// Whether seed was given. Otherwise the random numbers are seeded from the clock.
+	uint64_t seed = 0;		// Seed of every random number the AI draws, for reproducible searches
+	int threads = 1;		// Number of threads evaluating candidate moves
+	int simulations = SIMUL;	// Simulations per candidate move
+	long long playouts = 0;	// Simulations per move of the tree search and of successive halving. 0: simulations times the number of candidate moves
+	bool paired = false;	// Evaluate every candidate on the same random fills (common random numbers)
+	bool rave = true;		// Tree search: blend all-moves-as-first statistics into the move values (RAVE)
+	bool reuse = true;		// Tree search: keep the subtree of the position reached at the next AI move
+	bool ponder = false;	// Tree search: keep searching while the human thinks about their move
+	PruneRule pruning = EXACT_BOUND;	// When ordered pruning stops evaluating a candidate
+	double pruneError = 0.05;	// Confidence bound: chance that a candidate better than the best so far is stopped
+	bool auditPruning = false;	// Confidence bound: finish the stopped candidates anyway, to count the wrong stops
+};
 
 inline pair<int, int> coordinates(string command){
-	string substring = command.substr(1,2);
+	string substring = command.substr(1);
 	int x = 0;
 	int y = 0;
 
@@ -54,326 +118,1034 @@ inline pair<int, int> coordinates(string command){
 	return {x, y};
 }
 
+// Stone mask with one bit per board cell, stored in W 64-bit words. Bit i corresponds to board node i = x * N + y.
+template<int W>
+struct BitBoard {
+	uint64_t w[W] = {};
+
+	constexpr void set(const int& i) { w[i >> 6] |= 1ULL << (i & 63); }
+	constexpr void reset(const int& i) { w[i >> 6] &= ~(1ULL << (i & 63)); }
+	constexpr bool test(const int& i) const { return (w[i >> 6] >> (i & 63)) & 1; }
+	constexpr bool any() const {
+		uint64_t r = 0;
+		for (int k = 0; k < W; ++k) r |= w[k];
+		return r != 0;
+	}
+	constexpr bool operator==(const BitBoard& b) const {
+		uint64_t r = 0;
+		for (int k = 0; k < W; ++k) r |= w[k] ^ b.w[k];
+		return r == 0;
+	}
+	constexpr bool operator!=(const BitBoard& b) const { return !(*this == b); }
+	constexpr BitBoard operator&(const BitBoard& b) const {
+		BitBoard r;
+		for (int k = 0; k < W; ++k) r.w[k] = w[k] & b.w[k];
+		return r;
+	}
+	constexpr BitBoard operator|(const BitBoard& b) const {
+		BitBoard r;
+		for (int k = 0; k < W; ++k) r.w[k] = w[k] | b.w[k];
+		return r;
+	}
+	constexpr BitBoard operator^(const BitBoard& b) const {
+		BitBoard r;
+		for (int k = 0; k < W; ++k) r.w[k] = w[k] ^ b.w[k];
+		return r;
+	}
+	// Returns the number of set bits
+	int count() const {
+		int c = 0;
+		for (int k = 0; k < W; ++k) c += static_cast<int>(bitset<64>(w[k]).count());
+		return c;
+	}
+	// Returns the node of the r-th set bit, counting from 0, r < count()
+	int select(int r) const {
+		int k = 0;
+		for (int c; (c = static_cast<int>(bitset<64>(w[k]).count())) <= r; ++k)
+			r -= c;
+		uint64_t x = w[k];
+#ifdef __BMI2__
+		x = _pdep_u64(1ULL << r, x);	// Deposits a single bit at the r-th set bit of x
+#else
+		for (; r > 0; --r) x &= x - 1;	// Clears the r lowest set bits
+#endif
+		return (k << 6) + static_cast<int>(bitset<64>((x & (0 - x)) - 1).count());	// Position of the lowest set bit
+	}
+	// Returns the n bits (n < 64) starting at node pos, as the low bits of a word
+	constexpr uint64_t extract(const int& pos, const int& n) const {
+		int k = pos >> 6, off = pos & 63;
+		uint64_t r = w[k] >> off;
+		if (off + n > 64 && k + 1 < W)
+			r |= w[k + 1] << (64 - off);
+		return r & ((1ULL << n) - 1);
+	}
+};
+
+// Moves node i to i + K, 0 < K < 64
+template<int K, int W>
+constexpr BitBoard<W> shiftUp(const BitBoard<W>& b){
+	static_assert(K > 0 && K < 64, "shift must be within one word");
+	BitBoard<W> r;
+	for (int k = W - 1; k > 0; --k)
+		r.w[k] = (b.w[k] << K) | (b.w[k - 1] >> (64 - K));
+	r.w[0] = b.w[0] << K;
+	return r;
+}
+
+// Moves node i to i - K, 0 < K < 64
+template<int K, int W>
+constexpr BitBoard<W> shiftDown(const BitBoard<W>& b){
+	static_assert(K > 0 && K < 64, "shift must be within one word");
+	BitBoard<W> r;
+	for (int k = 0; k < W - 1; ++k)
+		r.w[k] = (b.w[k] >> K) | (b.w[k + 1] << (64 - K));
+	r.w[W - 1] = b.w[W - 1] >> K;
+	return r;
+}
+
+// Four 64-bit words, one per lane, operated on together. With AVX2 they are held in one 256-bit register,
+// otherwise in a plain array, so the same batched code builds everywhere.
+struct U64x4 {
+#ifdef __AVX2__
+	__m256i v;
+
+	static U64x4 load(const uint64_t* p) { return {_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p))}; }
+	static U64x4 broadcast(const uint64_t& x) { return {_mm256_set1_epi64x(static_cast<long long>(x))}; }
+	U64x4 operator&(const U64x4& b) const { return {_mm256_and_si256(v, b.v)}; }
+	U64x4 operator|(const U64x4& b) const { return {_mm256_or_si256(v, b.v)}; }
+	U64x4 operator^(const U64x4& b) const { return {_mm256_xor_si256(v, b.v)}; }
+	template<int K> U64x4 shl() const { return {_mm256_slli_epi64(v, K)}; }
+	template<int K> U64x4 shr() const { return {_mm256_srli_epi64(v, K)}; }
+	bool any() const { return !_mm256_testz_si256(v, v); }
+	// Bit l of the result is set when lane l is not zero
+	unsigned nonzeroLanes() const {
+		__m256i zero = _mm256_cmpeq_epi64(v, _mm256_setzero_si256());
+		return ~static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(zero))) & 0xF;
+	}
+#else
+	uint64_t v[4];
+
+	static U64x4 load(const uint64_t* p) { return {{p[0], p[1], p[2], p[3]}}; }
+	static U64x4 broadcast(const uint64_t& x) { return {{x, x, x, x}}; }
+	U64x4 operator&(const U64x4& b) const { return {{v[0] & b.v[0], v[1] & b.v[1], v[2] & b.v[2], v[3] & b.v[3]}}; }
+	U64x4 operator|(const U64x4& b) const { return {{v[0] | b.v[0], v[1] | b.v[1], v[2] | b.v[2], v[3] | b.v[3]}}; }
+	U64x4 operator^(const U64x4& b) const { return {{v[0] ^ b.v[0], v[1] ^ b.v[1], v[2] ^ b.v[2], v[3] ^ b.v[3]}}; }
+	template<int K> U64x4 shl() const { return {{v[0] << K, v[1] << K, v[2] << K, v[3] << K}}; }
+	template<int K> U64x4 shr() const { return {{v[0] >> K, v[1] >> K, v[2] >> K, v[3] >> K}}; }
+	bool any() const { return (v[0] | v[1] | v[2] | v[3]) != 0; }
+	unsigned nonzeroLanes() const {
+		return (v[0] != 0) | (v[1] != 0) << 1 | (v[2] != 0) << 2 | (v[3] != 0) << 3;
+	}
+#endif
+};
+
+// Four stone masks side by side: word k of every mask is stored in w[k], one mask per lane.
+// It supports the operations of the flood fill, so the same fill runs on four boards at once.
+template<int W>
+struct BitBoardX4 {
+	U64x4 w[W];
+
+	BitBoardX4 operator&(const BitBoardX4& b) const {
+		BitBoardX4 r;
+		for (int k = 0; k < W; ++k) r.w[k] = w[k] & b.w[k];
+		return r;
+	}
+	BitBoardX4 operator|(const BitBoardX4& b) const {
+		BitBoardX4 r;
+		for (int k = 0; k < W; ++k) r.w[k] = w[k] | b.w[k];
+		return r;
+	}
+	// The same mask b applied to every lane
+	BitBoardX4 operator&(const BitBoard<W>& b) const {
+		BitBoardX4 r;
+		for (int k = 0; k < W; ++k) r.w[k] = w[k] & U64x4::broadcast(b.w[k]);
+		return r;
+	}
+	bool operator!=(const BitBoardX4& b) const {
+		U64x4 r = w[0] ^ b.w[0];
+		for (int k = 1; k < W; ++k) r = r | (w[k] ^ b.w[k]);
+		return r.any();
+	}
+	// Bit l of the result is set when the mask in lane l is not empty
+	unsigned nonzeroLanes() const {
+		U64x4 r = w[0];
+		for (int k = 1; k < W; ++k) r = r | w[k];
+		return r.nonzeroLanes();
+	}
+};
+
+// Moves node i to i + K in every lane, 0 < K < 64
+template<int K, int W>
+BitBoardX4<W> shiftUp(const BitBoardX4<W>& b){
+	static_assert(K > 0 && K < 64, "shift must be within one word");
+	BitBoardX4<W> r;
+	for (int k = W - 1; k > 0; --k)
+		r.w[k] = b.w[k].template shl<K>() | b.w[k - 1].template shr<64 - K>();
+	r.w[0] = b.w[0].template shl<K>();
+	return r;
+}
+
+// Moves node i to i - K in every lane, 0 < K < 64
+template<int K, int W>
+BitBoardX4<W> shiftDown(const BitBoardX4<W>& b){
+	static_assert(K > 0 && K < 64, "shift must be within one word");
+	BitBoardX4<W> r;
+	for (int k = 0; k < W - 1; ++k)
+		r.w[k] = b.w[k].template shr<K>() | b.w[k + 1].template shl<64 - K>();
+	r.w[W - 1] = b.w[W - 1].template shr<K>();
+	return r;
+}
+
+// Range over the neighbors of a node, as stored in the neighbor table
+template<typename T>
+struct NeighborRange {
+	const T* first;
+	const T* last;
+	const T* begin() const { return first; }
+	const T* end() const { return last; }
+};
+
+// Read-only adjacency of an N x N hex board, built at compile time.
+// Each cell has at most 6 neighbor cells, plus the virtual nodes of the borders it touches.
+// Each virtual node has the N cells of its border as neighbors.
+template<int N>
+struct HexTopology {
+	static constexpr int CELLS = N * N;			// Number of board cells
+	static constexpr int NODES = CELLS + 4;		// Board cells + 4 virtual nodes
+	static constexpr int WEST = CELLS;			// Node (d^2) represents WEST virtual node
+	static constexpr int EAST = CELLS + 1;		// Node (d^2 + 1) represents EAST virtual node
+	static constexpr int NORTH = CELLS + 2;		// Node (d^2 + 2) represents NORTH virtual node
+	static constexpr int SOUTH = CELLS + 3;		// Node (d^2 + 3) represents SOUTH virtual node
+	static constexpr int EDGES = 3 * N * N + 1;	// (N-1)N horizontal + (N-1)N vertical + (N-1)^2 diagonal + 4N virtual edges
+	static constexpr int WORDS = (CELLS + 63) / 64;	// 64-bit words per stone mask
+
+	using Index = conditional_t<(NODES < 256), uint8_t, uint16_t>;	// Smallest type that holds any node number
+	using Mask = BitBoard<WORDS>;
+
+	array<uint16_t, NODES + 1> offset{};	// Neighbors of node n are nbr[offset[n]] .. nbr[offset[n + 1] - 1]
+	array<Index, 2 * EDGES> nbr{};			// Neighbor lists of all nodes, stored back to back
+	Mask full;				// All cells of the board
+	Mask notFirstCol;		// All cells except column 0
+	Mask notLastCol;		// All cells except column N - 1
+	Mask startBorder[3];	// Border cells next to the start node of Player 1(1) and Player 2(2)
+	Mask endBorder[3];		// Border cells next to the end node of Player 1(1) and Player 2(2)
+
+	constexpr HexTopology();
+	NeighborRange<Index> neighbors(const int& node) const;	// Returns the neighbors of node
+	template<typename M>
+	constexpr M spread(const M& b) const;	// Returns the cells adjacent to any cell of b (a Mask, or one per lane of a BitBoardX4)
+};
+
+template<int N>
+constexpr HexTopology<N>::HexTopology() {
+	int k = 0;	// Next free slot in nbr
+	for (int x = 0; x < N; ++x){
+		for (int y = 0; y < N; ++y){
+			int iNode = x * N + y;
+			offset[iNode] = k;
+			// Neighbor cells, in the order upper left, upper right, left, lower left, right, lower right
+			if (x > 0){
+				nbr[k++] = (x - 1) * N + y;
+				if (y < N - 1)
+					nbr[k++] = (x - 1) * N + y + 1;
+			}
+			if (y > 0){
+				nbr[k++] = x * N + y - 1;
+				if (x < N - 1)
+					nbr[k++] = (x + 1) * N + y - 1;
+			}
+			if (y < N - 1)
+				nbr[k++] = x * N + y + 1;
+			if (x < N - 1)
+				nbr[k++] = (x + 1) * N + y;
+
+			// Border cells are also connected to the virtual node of their border
+			if (x == 0)		nbr[k++] = NORTH;
+			if (x == N - 1)	nbr[k++] = SOUTH;
+			if (y == 0)		nbr[k++] = WEST;
+			if (y == N - 1)	nbr[k++] = EAST;
+
+			// Masks used by the bitboard flood fill
+			full.set(iNode);
+			if (y > 0)		notFirstCol.set(iNode);
+			if (y < N - 1)	notLastCol.set(iNode);
+			if (x == 0)		startBorder[1].set(iNode);
+			if (x == N - 1)	endBorder[1].set(iNode);
+			if (y == 0)		startBorder[2].set(iNode);
+			if (y == N - 1)	endBorder[2].set(iNode);
+		}
+	}
+	offset[WEST] = k;
+	for (int i = 0; i < N; ++i) nbr[k++] = i * N;
+	offset[EAST] = k;
+	for (int i = 0; i < N; ++i) nbr[k++] = i * N + N - 1;
+	offset[NORTH] = k;
+	for (int i = 0; i < N; ++i) nbr[k++] = i;
+	offset[SOUTH] = k;
+	for (int i = 0; i < N; ++i) nbr[k++] = (N - 1) * N + i;
+	offset[NODES] = k;
+}
+
+template<int N>
+NeighborRange<typename HexTopology<N>::Index> HexTopology<N>::neighbors(const int& node) const{
+	return {nbr.data() + offset[node], nbr.data() + offset[node + 1]};
+}
+
+// Shifts b towards each of the 6 hex directions. Shifts that move a cell across the left or right edge
+// of the board are masked beforehand, so no cell wraps around to the other side of the board.
+template<int N>
+template<typename M>
+constexpr M HexTopology<N>::spread(const M& b) const{
+	M left = b & notFirstCol;	// Cells that have neighbors to their left
+	M right = b & notLastCol;	// Cells that have neighbors to their right
+	return (shiftUp<N>(b) | shiftDown<N>(b)					// Lower right, upper left
+		| shiftUp<1>(right) | shiftDown<1>(left)			// Right, left
+		| shiftDown<N - 1>(right) | shiftUp<N - 1>(left)	// Upper right, lower left
+		) & full;
+}
+
+// The one neighbor table of each board size, shared by every Graph of that size
+template<int N>
+inline constexpr HexTopology<N> hexTopology{};
+
+// SplitMix64 step, used to generate fixed pseudo-random keys at compile time
+constexpr uint64_t splitMix64(uint64_t& state){
+	uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+// xoshiro256** pseudo-random generator (Blackman and Vigna): 256 bits of state, a few shifts, rotations and
+// multiplies per number, and no system call once seeded. Usable wherever the standard library expects an engine.
+class Xoshiro256 {
+	public:
+	using result_type = uint64_t;
+	explicit Xoshiro256(uint64_t seed = 0);
+	static constexpr uint64_t min() { return 0; }
+	static constexpr uint64_t max() { return UINT64_MAX; }
+	uint64_t operator()();				// Returns the next 64 random bits
+	uint32_t below(const uint32_t& n);	// Returns a uniform integer in [0, n), n > 0
+	void jump();						// Advances the state by 2^128 numbers, to split off non-overlapping streams
+
+	private:
+	uint64_t s[4];
+	static uint64_t rotl(const uint64_t& x, const int& k) { return (x << k) | (x >> (64 - k)); }
+};
+
+// The state is expanded from the seed with SplitMix64, so nearby seeds give unrelated streams
+inline Xoshiro256::Xoshiro256(uint64_t seed){
+	for (auto& word : s)
+		word = splitMix64(seed);
+}
+
+inline uint64_t Xoshiro256::operator()(){
+	uint64_t result = rotl(s[1] * 5, 7) * 9;
+	uint64_t t = s[1] << 17;
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = rotl(s[3], 45);
+	return result;
+}
+
+// Jump polynomial of xoshiro256, equivalent to 2^128 calls of operator()
+inline void Xoshiro256::jump(){
+	static constexpr uint64_t JUMP[4] = {0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL, 0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL};
+	uint64_t t[4] = {};
+	for (uint64_t j : JUMP)
+		for (int b = 0; b < 64; ++b){
+			if ((j >> b) & 1)
+				for (int k = 0; k < 4; ++k) t[k] ^= s[k];
+			(*this)();
+		}
+	copy(t, t + 4, s);
+}
+
+// Lemire's multiply-shift range reduction: the high half of a 32 x 32-bit product instead of a division.
+// Draws from the few low products that would bias the result are rejected.
+inline uint32_t Xoshiro256::below(const uint32_t& n){
+	uint64_t m = static_cast<uint64_t>(static_cast<uint32_t>((*this)() >> 32)) * n;
+	if (static_cast<uint32_t>(m) < n){
+		uint32_t threshold = -n % n;	// 2^32 mod n
+		while (static_cast<uint32_t>(m) < threshold)
+			m = static_cast<uint64_t>(static_cast<uint32_t>((*this)() >> 32)) * n;
+	}
+	return static_cast<uint32_t>(m >> 32);
+}
+
+// Returns a uniformly random subset of count cells of from, which has size cells, as a mask.
+// Each cell is first kept with probability 1/2 using whole words of random bits. Given how many were kept,
+// every subset of that size is equally likely, so removing (or adding) uniformly chosen cells until there are
+// count of them keeps the result uniform. Only about sqrt(size) cells need fixing on average.
+template<int W>
+BitBoard<W> randomSubset(const BitBoard<W>& from, const int& size, const int& count, Xoshiro256& rng){
+	BitBoard<W> r;
+	for (int k = 0; k < W; ++k)
+		r.w[k] = from.w[k] & rng();
+	int c = r.count();
+	for (; c > count; --c)
+		r.reset(r.select(rng.below(c)));
+	for (; c < count; ++c)
+		r.set((from ^ r).select(rng.below(size - c)));
+	return r;
+}
+
+// Zobrist keys of an N x N board: one random 64-bit key per cell and player.
+// The hash of a position is the XOR of the keys of its stones. key[0] (empty) is all zeros.
+template<int N>
+struct ZobristTable {
+	array<uint64_t, N * N> key[3] = {};
+
+	constexpr ZobristTable() {
+		uint64_t state = N;	// Different keys for each board size
+		for (int p = 1; p <= 2; ++p)
+			for (int i = 0; i < N * N; ++i)
+				key[p][i] = splitMix64(state);
+	}
+};
+
+template<int N>
+inline constexpr ZobristTable<N> zobristTable{};
+
 // Class that represents the game board as a graph
+template<int N>
 class Graph {
+	public:
+	using Topology = HexTopology<N>;
+	using Index = typename Topology::Index;
+	using Mask = typename Topology::Mask;
+
 	private:
-	vector<int> adjMatrix;	// Adjacency matrix of the graph
-	vector<char> sign;		// Keeps record of sign (X, O, or . , none)
-	int numVertices;		// Number of vertices in the graph
-	int numEdges;			// Number of edges in the graph
-	int startNode[3];		// Stores start node for Player 1(1) and Player 2(2)
-	int endNode[3];			// Stores end node for Player 1(1) and Player 2(2)
+	array<uint8_t, Topology::NODES> cells;	// Owner of each node (0: none, 1: Player 1, 2: Player 2), one byte per node.
+											// The 4 virtual nodes follow the d^2 board cells and keep their fixed owner.
+	Mask stones[3];			// Stone masks for Player 1(1) and Player 2(2), kept in sync with cells
+	uint64_t hash = 0;		// Zobrist hash of the stones on the board, kept in sync with cells
+	array<Index, Topology::NODES> parent;	// Disjoint-set forest over all nodes, joining neighbor stones of the same owner
+	array<Index, Topology::NODES> setSize;	// Number of nodes in the set, valid for set roots
+	array<Index, Topology::CELLS> empty;	// Empty cells; the first numEmpty entries are the empty cells, in no particular order
+	array<Index, Topology::CELLS> emptyPos;	// Position of each cell in empty
+	int numEmpty;				// Number of empty cells
+	vector<Index> history;		// Undo stack: for each move played, the absorbed set roots, the move's position in empty and its node
+	vector<uint16_t> moveStart;	// Undo stack: position in history where each move's entries begin
+
+	int find(int x) const;					// Returns the root of x's set
+	int unite(int rx, int ry);				// Merges the sets rooted at rx and ry, smaller under larger, returns the new root
+	void mark(const int& cell, const int& playerNum);	// Writes the owner of a board cell and its stone masks
 
 	public:
-	Graph() {};
-	Graph(int numVertices);		// Parameterized Graph constructor
+	Graph();
 	int V() const;						// Returns the number of vertices in the graph
-	int E() const;						// Returns the number of edges in the graph
-	bool adjacent (const int& x, const int& y) const;	// Tests whether there is an edge from node x to node y
-	int get_edge_value(const int& x, const int& y) const;	// Returns the value associated to the edge (x,y) from Node x to Node y
-	void set_edge_value(const int& x, const int& y, const int& value); // Sets the value associated to the edge (x,y) to value
+	NeighborRange<Index> neighbors(const int& x) const;	// Returns the neighbors of node x
+	const Mask& get_stones(const int& playerNum) const;	// Returns the stone mask based on player
+	uint64_t get_hash() const;							// Returns the Zobrist hash of the position
+	int get_owner(const int& node) const;				// Returns the owner of any node, virtual nodes included
+	int emptyCount() const;								// Returns the number of empty cells
+	int emptyCell(const int& i) const;					// Returns the i-th empty cell, 0 <= i < emptyCount()
 	char get_sign(const int& x, const int& y) const;			// Returns sign for node(x,y)
-	void set_sign(const int& x, const int& y, const char& s);	// Sets sign for node(x,y)
+	void set_sign(const int& x, const int& y, const char& s);	// Places the stone of sign s on node(x,y)
+	int node(const int& x, const int& y) const;					// Returns the node number of board position (x,y)
+	void play(const int& cell, const int& playerNum);	// Places a stone of the player on board node cell, recording it for undo
+	void undo();								// Takes back the last stone played
+	int movesPlayed() const;					// Returns the number of stones that can be taken back
 	int get_startNode(const int& playerNum) const;				// Returns start node based on player
 	int get_endNode(const int& playerNum) const;				// Returns end node based on player
+	bool connected(const int& x, const int& y) const;			// Tests whether nodes x and y are in the same chain of stones
+	int get_winner() const;					// 0: No winner, 1: Player 1 winner, 2: Player 2 winner
 };
 
-  // Initialize the matrix to zero
-Graph::Graph(int numVertices) {
-	this->numVertices = numVertices;
-	this->numEdges = 0;
-
-	// Creation of n x n adjacency matrix, initialized edges to INFINIT
-	adjMatrix.resize(numVertices * numVertices, INFINIT);
-	sign.resize(numVertices * numVertices, '.');
-	for (int i = 0; i < numVertices; ++i){
-		adjMatrix[i * numVertices + i] = 0; // For edge(i,j) where i = j, set edge value as 0
-	}
-
-	int vnodeWest, vnodeEast, vnodeNorth, vnodeSouth;
-  	vnodeWest = sizeofBoard*sizeofBoard;	// Node (d^2) represents WEST virtual node
-	vnodeEast = sizeofBoard*sizeofBoard + 1;	// Node (d^2 + 1) represents EAST virtual node
-	vnodeNorth = sizeofBoard*sizeofBoard + 2; 	// Node (d^2 + 2) represents SOUTH virtual node
-	vnodeSouth = sizeofBoard*sizeofBoard + 3;	// Node (d^2 + 3) represents NORTH virtual node
-
-	int x, y;	// x,y coordinates for setting node sign
-
-	// Connect all north nodes(row 0) to virtual north node
-	x = vnodeNorth / sizeofBoard;
-	y = vnodeNorth % sizeofBoard;
-	set_sign(x, y, 'X');
-	for (int i = 0; i < sizeofBoard; i++){
-		set_edge_value(vnodeNorth, i, 1);
-	}
-	// Connect all south nodes(row n - 1) to virtual south node
-	x = vnodeSouth / sizeofBoard;
-	y = vnodeSouth % sizeofBoard;
-	set_sign(x, y, 'X');
-	for (int j = V() - 1; j >= V() - sizeofBoard; j--){
-		set_edge_value(vnodeSouth, j, 1);
-	}
-	// Connect all west nodes(column 0) to virtual west node
-	x = vnodeWest / sizeofBoard;
-	y = vnodeWest % sizeofBoard;
-	set_sign(x, y, 'O');
-	for (int i = 0; i < V(); i = i + sizeofBoard){
-		set_edge_value(vnodeWest, i, 1);
-	}
-	// Connect all east nodes(column n - 1) to virtual east node
-	x = vnodeEast / sizeofBoard;
-	y = vnodeEast % sizeofBoard;
-	set_sign(x, y, 'O');
-	for (int j = sizeofBoard - 1; j < V(); j = j + sizeofBoard){
-		set_edge_value(vnodeEast, j, 1);
-	}
-
-	// Player 1 connects from North - South
-	startNode[1] = vnodeNorth;
-	endNode[1] = vnodeSouth;
-
-	// Player 2 connects from West - East
-	startNode[2] = vnodeWest;
-	endNode[2] = vnodeEast;
-	
+template<int N>
+Graph<N>::Graph() {
+	// All board cells start empty. Virtual north and south nodes belong to player 1, west and east to player 2
+	cells.fill(0);
+	cells[Topology::NORTH] = cells[Topology::SOUTH] = 1;
+	cells[Topology::WEST] = cells[Topology::EAST] = 2;
+
+	// Every node starts in its own set. The virtual nodes are permanent members of their player's chains.
+	for (int i = 0; i < Topology::NODES; ++i){
+		parent[i] = i;
+		setSize[i] = 1;
+	}
+	for (int i = 0; i < Topology::CELLS; ++i){
+		empty[i] = i;
+		emptyPos[i] = i;
+	}
+	numEmpty = Topology::CELLS;
+
+	history.reserve(8 * Topology::CELLS);	// At most 6 unions + position + the stone itself per move
+	moveStart.reserve(Topology::CELLS);
+}
+
+template<int N>
+int Graph<N>::V() const{
+	return Topology::CELLS; // Returns the number of vertices in the graph
+}
+
+template<int N>
+NeighborRange<typename Graph<N>::Index> Graph<N>::neighbors(const int& x) const{
+	return hexTopology<N>.neighbors(x);
+}
+
+template<int N>
+int Graph<N>::get_owner(const int& node) const{
+	return cells[node];
+}
+
+template<int N>
+int Graph<N>::emptyCount() const{
+	return numEmpty;
+}
+
+template<int N>
+int Graph<N>::emptyCell(const int& i) const{
+	return empty[i];
 }
 
-int Graph::V() const{
-	return numVertices - 4; // Returns the number of vertices in the graph
+template<int N>
+char Graph<N>::get_sign(const int& x, const int& y) const{
+	static const char signs[3] = {'.', 'X', 'O'};
+	return signs[cells[node(x, y)]]; // Return sign value
 }
 
-int Graph::E() const{
-	return numEdges; // Returns the number of edges in the graph
+// Places a stone through play, so it can be taken back with undo.
+template<int N>
+void Graph<N>::set_sign(const int& x, const int& y, const char& s){
+	play(node(x, y), (s == 'X') ? 1 : 2);
 }
 
-  // Return true if x and y are neighbors, false if not
-bool Graph::adjacent (const int& x, const int& y) const{
-  	return (get_edge_value(x, y) != INFINIT && get_edge_value(x, y) != 0);
+template<int N>
+int Graph<N>::node(const int& x, const int& y) const{
+	return x * N + y;
 }
 
-int Graph::get_edge_value(const int& x, const int& y) const{
-	return (adjMatrix[x * numVertices + y]); // Return edge value
+template<int N>
+void Graph<N>::mark(const int& cell, const int& playerNum){
+	hash ^= zobristTable<N>.key[cells[cell]][cell] ^ zobristTable<N>.key[playerNum][cell];	// Remove old owner, add new one
+	cells[cell] = playerNum;
+	stones[1].reset(cell);
+	stones[2].reset(cell);
+	if (playerNum != 0)
+		stones[playerNum].set(cell);
 }
 
-void Graph::set_edge_value(const int& x, const int& y, const int& value){
-	if (adjacent(x,y) == false){ // If there is not an existing edge, increment number of edges
-  		++numEdges;
+// Places the stone and joins it with every neighbor stone (or virtual node) of the same owner.
+// Every set root absorbed by a union is pushed to the undo stack, so the forest can be rolled back exactly.
+template<int N>
+void Graph<N>::play(const int& cell, const int& playerNum){
+	mark(cell, playerNum);
+	moveStart.push_back(history.size());
+
+	// Remove the cell from the empty list by swapping it with the last empty cell
+	int pos = emptyPos[cell];
+	int last = empty[--numEmpty];
+	empty[pos] = last;
+	emptyPos[last] = pos;
+	empty[numEmpty] = cell;
+	emptyPos[cell] = numEmpty;
+
+	int root = cell;	// Root of the set holding the new stone
+	for (int n : neighbors(cell)){
+		if (cells[n] == playerNum){
+			int rn = find(n);
+			if (rn != root){
+				int merged = unite(root, rn);
+				history.push_back(merged == rn ? root : rn);	// The root that was absorbed
+				root = merged;
+			}
+		}
 	}
-	adjMatrix[x * numVertices + y] = adjMatrix[y * numVertices + x] = value; // add new edge value
+	history.push_back(pos);
+	history.push_back(cell);
 }
 
-char Graph::get_sign(const int& x, const int& y) const{
-	return (sign[x * numVertices + y]); // Return sign value
+template<int N>
+void Graph<N>::undo(){
+	int cell = history.back();
+	history.pop_back();
+	int pos = history.back();
+	history.pop_back();
+
+	// Swap the cell back to its old position in the empty list
+	int moved = empty[pos];
+	empty[numEmpty] = moved;
+	emptyPos[moved] = numEmpty;
+	empty[pos] = cell;
+	emptyPos[cell] = pos;
+	++numEmpty;
+
+	// Undo the unions in reverse order: detach each absorbed root from its parent
+	while (static_cast<int>(history.size()) > moveStart.back()){
+		int r = history.back();
+		history.pop_back();
+		setSize[parent[r]] -= setSize[r];
+		parent[r] = r;
+	}
+	moveStart.pop_back();
+	mark(cell, 0);
 }
 
-void Graph::set_sign(const int& x, const int& y, const char& s){
-	sign[x * numVertices + y] = s; // add new sign value	
+template<int N>
+int Graph<N>::movesPlayed() const{
+	return moveStart.size();
 }
 
-int Graph::get_startNode(const int& playerNum) const{
-	return (startNode[playerNum]);	// Return start node
+// No path compression, so that unions can be undone. Union by size keeps the trees O(log n) deep.
+template<int N>
+int Graph<N>::find(int x) const{
+	while (parent[x] != x)
+		x = parent[x];
+	return x;
 }
 
-int Graph::get_endNode(const int& playerNum) const{
-	return (endNode[playerNum]);	// Return end node
+template<int N>
+int Graph<N>::unite(int rx, int ry){
+	if (setSize[rx] < setSize[ry])
+		swap(rx, ry);
+	parent[ry] = rx;
+	setSize[rx] += setSize[ry];
+	return rx;
 }
 
-// Evaluates game winner
-class Evaluate{
+template<int N>
+bool Graph<N>::connected(const int& x, const int& y) const{
+	return find(x) == find(y);
+}
+
+// A player has won once their start and end virtual nodes are in the same set
+template<int N>
+int Graph<N>::get_winner() const{
+	if (connected(Topology::NORTH, Topology::SOUTH))
+		return 1;
+	if (connected(Topology::WEST, Topology::EAST))
+		return 2;
+	return 0;
+}
+
+template<int N>
+const typename Graph<N>::Mask& Graph<N>::get_stones(const int& playerNum) const{
+	return stones[playerNum];
+}
+
+template<int N>
+uint64_t Graph<N>::get_hash() const{
+	return hash;
+}
+
+// Player 1 connects from North - South, Player 2 connects from West - East
+template<int N>
+int Graph<N>::get_startNode(const int& playerNum) const{
+	return (playerNum == 1) ? Topology::NORTH : Topology::WEST;	// Return start node
+}
+
+template<int N>
+int Graph<N>::get_endNode(const int& playerNum) const{
+	return (playerNum == 1) ? Topology::SOUTH : Topology::EAST;	// Return end node
+}
+
+// Positions of many boards, stored as a structure of arrays: for each player and each word k of the stone masks,
+// one contiguous array holds word k of every board. Four consecutive boards load straight into the lanes of a BitBoardX4.
+template<int N>
+class BoardSet {
 	public:
-	bool isReachable(const Graph& g, int s, const int& d, const char& sign);
-	int winnerAI(const Graph& g, const int& playerNum);
+	static constexpr int WORDS = HexTopology<N>::WORDS;
+	using Lanes = BitBoardX4<WORDS>;
+
+	void add(const Graph<N>& g);	// Appends the position of g
+	void add(const typename HexTopology<N>::Mask& own1, const typename HexTopology<N>::Mask& own2);	// Appends a position by its stones
+	void clear();					// Removes all boards, keeping the storage
+	int size() const;				// Returns the number of boards
+	bool allFull() const;			// Tests whether no board of the set has empty cells
+	Lanes lanes(const int& playerNum, const int& first, const int& count) const;	// Stones of boards first .. first+count-1, count <= 4
+
+	private:
+	vector<uint64_t> planes[2][WORDS];	// planes[p - 1][k][b]: word k of Player p's stones on board b
+	int numBoards = 0;
+	bool full = true;
 };
 
+template<int N>
+void BoardSet<N>::add(const Graph<N>& g){
+	add(g.get_stones(1), g.get_stones(2));
+}
 
-// A BFS based function to check whether d is reachable from s.
-bool Evaluate::isReachable(const Graph& g, int s, const int& d, const char& sign)
-{   
-    list<int> adj; // list of neighbors y of x, if any
-
-    // Base case
-    if (s == d)
-        return true;
- 
-    // Mark all the vertices as not visited
-    bool* visited = new bool[g.V()];
-    for (int i = 0; i < g.V() + 4; i++)
-        visited[i] = false;
- 
-    // Create a queue for BFS
-    list<int> queue;
- 
-    // Mark the current node as visited and enqueue it
-    visited[s] = true;
-    queue.push_back(s);
- 
-    // it will be used to get all adjacent vertices of a vertex
-    // list<int>::iterator i;
- 
-    while (!queue.empty()) {
-        
-        // Dequeue a vertex from queue and print it
-        s = queue.front();
-        queue.pop_front();
-
-        // cout << "Neighbors for node " << s << " are: " << endl;
-        for (int y = 0; y < g.V() + 4; y++){
-			// Convert u node into i,j positions
-			int i = y / sizeofBoard;
-			int j = y % sizeofBoard;
-			int m = s / sizeofBoard;
-			int n = s % sizeofBoard;
-            if (g.adjacent(s,y) == true && g.get_sign(i,j) == sign && g.get_sign(m,n) == sign){
-                adj.push_back(y);
-                // cout << "node " << y << endl;
-            }
-	    }
-
-        // Get all adjacent vertices of the dequeued vertex s
-        // If a adjacent has not been visited, then mark it
-        // visited  and enqueue it
-        for (auto i: adj) {
- 
-            // If this adjacent node is the destination node,
-            // then return true
-            if (i == d)
-                return true;
- 
-            // Else, continue to do BFS
-            if (!visited[i]) {
-                visited[i] = true;
-                queue.push_back(i);
-            }
-        }
-    }
- 
-    // If BFS is complete without visiting d
-	// cout << " returned false" << endl;
-    return false;
+template<int N>
+void BoardSet<N>::add(const typename HexTopology<N>::Mask& own1, const typename HexTopology<N>::Mask& own2){
+	for (int k = 0; k < WORDS; ++k){
+		planes[0][k].push_back(own1.w[k]);
+		planes[1][k].push_back(own2.w[k]);
+	}
+	full = full && (own1 | own2) == hexTopology<N>.full;
+	++numBoards;
 }
 
-// 1st and main method for determining winner, using a BFS approach
-int Evaluate::winnerAI(const Graph& g, const int& playerNum){
-	int winner = 0; // 0: No winner, 1: Player 1 winner, 2: Player 2 winner
-	bool won;
-	char sign;
-	int i,j;
+template<int N>
+void BoardSet<N>::clear(){
+	for (auto& player : planes)
+		for (auto& plane : player)
+			plane.clear();
+	numBoards = 0;
+	full = true;
+}
 
-	if (playerNum == 1){
-		sign = 'X';
+template<int N>
+int BoardSet<N>::size() const{
+	return numBoards;
+}
 
-		// Check if player 1 has won
-		i = g.get_startNode(playerNum);
-		j = g.get_endNode(playerNum);
-		won = isReachable(g, i, j, sign);
-		if (won == true){
-			return playerNum;
-		}
-		// Else check if player 2 has won
-		else{
-			i = g.get_startNode(2);
-			j = g.get_endNode(2);
-			won = isReachable(g, i, j, 'O');
-			if (won == true){
-				return 2;	
-			}
-		}
-	}
-	else{
-		sign = 'O';
+template<int N>
+bool BoardSet<N>::allFull() const{
+	return full;
+}
 
-		// Check if player 2 has won
-		i = g.get_startNode(playerNum);
-		j = g.get_endNode(playerNum);
-		won = isReachable(g, i, j, sign);
-		if (won == true){
-			return playerNum;
-		}
-		// Else check if player 1 has won
+// A full group of four boards is loaded directly from each plane. A shorter group at the end of the set
+// is copied first, with its unused lanes left empty.
+template<int N>
+typename BoardSet<N>::Lanes BoardSet<N>::lanes(const int& playerNum, const int& first, const int& count) const{
+	Lanes r;
+	for (int k = 0; k < WORDS; ++k){
+		const uint64_t* words = planes[playerNum - 1][k].data() + first;
+		if (count == 4)
+			r.w[k] = U64x4::load(words);
 		else{
-			i = g.get_startNode(1);
-			j = g.get_endNode(1);
-			won = isReachable(g, i, j, 'X');
-			if (won == true)
-				return 1;	
+			uint64_t tail[4] = {};
+			copy(words, words + count, tail);
+			r.w[k] = U64x4::load(tail);
 		}
 	}
-	
-	return winner;
-
+	return r;
 }
 
-// Class in charge of displaying board, determining AI's move, etc.
-class hexGame{
+// Evaluates game winner
+template<int N>
+class Evaluate{
 	public:
-	Evaluate game;	// Class object init, to evaluate game winner
-	void setEdges(const int& x, const int& y, Graph* g);	
-	void drawBoard(const Graph& g);
-	bool validMove(const Graph& g, const string& command);
-	vector<pair <int, int> > availablePositions(const Graph& g) const;
-	void aiMove(Graph* g, const int& playerNum);	// Sets the best possible move returned from the mcs function
-	pair<int, int> monteCarloSims(const Graph& g, const int& playerNum);	// mcs function responsible for determining AI's best move
-	double probMonteCarlo(Graph g, const pair<int,int>& i, const double& bestProb, const int& playerNum, const int& numsim=SIMUL);
-	bool playerMove(Graph* g, string command, const int& playerNum);
-
+	static constexpr int SCANLINE_MINSIDE = 13;		// Smallest board side whose full boards are checked with the scanline fill
+	static constexpr int LANES = 4;					// Boards flood filled together by winnerBatch
+#ifdef __AVX2__
+	static constexpr bool BATCH_FULL = (N < SCANLINE_MINSIDE);	// Check the full boards of fill playouts with winnerBatch
+#else
+	static constexpr bool BATCH_FULL = false;	// Without AVX2 the lanes are plain loops, slower than one fill per board
+#endif
+	bool isConnected(const Graph<N>& g, const int& playerNum);
+	bool isConnected(const typename Graph<N>::Mask& own, const int& playerNum);	// Flood fill over the player's stone mask own
+	int winnerAI(const Graph<N>& g, const int& playerNum);
+	int winnerFull(const Graph<N>& g);	// Winner of a board with no empty cells
+	int winnerFull(const typename Graph<N>::Mask& own);	// Same, given Player 1's stones of the full board
+	unsigned connectedLanes(const typename BoardSet<N>::Lanes& own, const int& playerNum);	// isConnected for LANES boards at once
+	void winnerBatch(const BoardSet<N>& boards, vector<int>& results);	// Winner of every board of the set, in order
 };
 
-// Sets corresponding edges to node (x,y)
-void hexGame::setEdges(const int& x, const int& y, Graph* g){
 
-	// Maps (x,y) coordinate to corresponding node number on N sized board, from Node 0 to Node N - 1.
-	// e.g. for a board of size 7: Node coord (0, 6) = ( (0 * 7) + 6 ) = Node 6 
-	int iNode = (x * sizeofBoard + y);	// Node i
-	int jNode;	// Node j from which Node i shares an edge with
+// Checks whether the player's stones connect both of the player's borders.
+// Uses a bitboard flood fill: starting from the player's stones on the start border,
+// the reached set grows by one hex step per iteration until it stops changing.
+template<int N>
+bool Evaluate<N>::isConnected(const Graph<N>& g, const int& playerNum){
+	return isConnected(g.get_stones(playerNum), playerNum);
+}
 
-	
-	// Set the number of edges based on node (x,y)'s position
-	// Corner pieces : Have either 2 or 3 edges depending on corner
-	// Edge pieces : Have 4 edges
-	// Internal pieces : Have 6 edges
-
-	if (x > 0){
-		jNode = ( (x - 1) * sizeofBoard + y ); // Node j is to the upper left of Node i
-		(*g).set_edge_value(iNode, jNode, 1); // Set the edge from Node i to j
-		if (y < sizeofBoard - 1){
-			jNode = ( (x - 1) * sizeofBoard + y + 1 ); // Node j is to the upper right of Node i
-			(*g).set_edge_value(iNode, jNode, 1); // Set the edge from Node i to j
-		}
+template<int N>
+bool Evaluate<N>::isConnected(const typename Graph<N>::Mask& own, const int& playerNum){
+	const HexTopology<N>& t = hexTopology<N>;
+	auto reached = own & t.startBorder[playerNum];
+	typename Graph<N>::Mask previous;
+	do{
+		previous = reached;
+		reached = reached | (t.spread(reached) & own);
+	} while (reached != previous);
+
+	return (reached & t.endBorder[playerNum]).any();
+}
+
+// 1st and main method for determining winner, using a bitboard flood fill
+template<int N>
+int Evaluate<N>::winnerAI(const Graph<N>& g, const int& playerNum){
+	int other = (playerNum * 2) % 3;	// The opponent of playerNum
+
+	// Check if playerNum has won, else check if the opponent has won
+	if (isConnected(g, playerNum))
+		return playerNum;
+	if (isConnected(g, other))
+		return other;
+
+	return 0; // 0: No winner, 1: Player 1 winner, 2: Player 2 winner
+}
+
+// Extends seed through the runs of own it touches, within one row of the board (bit y is column y).
+// Kogge-Stone fill: each step doubles the distance covered, 5 steps per direction cover rows of up to 32 cells.
+inline uint32_t fillRow(uint32_t seed, uint32_t own){
+	uint32_t x = seed & own;
+	uint32_t p = own;	// Cells the fill may still cross, towards higher columns
+	x |= p & (x << 1);	p &= p << 1;
+	x |= p & (x << 2);	p &= p << 2;
+	x |= p & (x << 4);	p &= p << 4;
+	x |= p & (x << 8);	p &= p << 8;
+	x |= p & (x << 16);
+	p = own;			// Towards lower columns
+	x |= p & (x >> 1);	p &= p >> 1;
+	x |= p & (x >> 2);	p &= p >> 2;
+	x |= p & (x >> 4);	p &= p >> 4;
+	x |= p & (x >> 8);	p &= p >> 8;
+	x |= p & (x >> 16);
+	return x;
+}
+
+// On a completely filled hex board exactly one player has won, so only Player 1's connection is checked.
+// Small boards use the flood fill. From SCANLINE_MINSIDE up, a scanline fill over the rows of Player 1's stones
+// is faster: a downward sweep carries the cells reached from NORTH into each next row and spreads them along
+// the row's runs, an upward sweep does the same from below. On dense boards chains rarely turn back more than
+// a few times, so only a few sweeps are needed.
+template<int N>
+int Evaluate<N>::winnerFull(const Graph<N>& g){
+	return winnerFull(g.get_stones(1));
+}
+
+template<int N>
+int Evaluate<N>::winnerFull(const typename Graph<N>::Mask& own){
+	if constexpr (N < SCANLINE_MINSIDE)
+		return isConnected(own, 1) ? 1 : 2;
+
+	uint32_t rows[N];		// Player 1's stones, one row per word
+	uint32_t reach[N];		// Cells of each row connected to NORTH
+	for (int r = 0; r < N; ++r){
+		rows[r] = own.extract(r * N, N);
+		reach[r] = 0;
 	}
-	if (y > 0){
-		jNode = (x * sizeofBoard + y - 1); // Node j is to the left of Node i
-		(*g).set_edge_value(iNode, jNode, 1); // Set the edge from Node i to j
-		if (x < sizeofBoard - 1){
-			jNode = ( (x + 1) * sizeofBoard + y - 1 ); // Node j is to the lower left of Node i
-			(*g).set_edge_value(iNode, jNode, 1); // Set the edge from Node i to j
+	reach[0] = rows[0];	// Every stone on the first row touches NORTH
+
+	bool changed;
+	do{
+		// Downward sweep: cell (r, y) touches (r - 1, y) and (r - 1, y + 1)
+		for (int r = 1; r < N; ++r)
+			reach[r] = fillRow(reach[r] | reach[r - 1] | (reach[r - 1] >> 1), rows[r]);
+		if (reach[N - 1] != 0)
+			return 1;
+
+		// Upward sweep: cell (r, y) touches (r + 1, y) and (r + 1, y - 1)
+		changed = false;
+		for (int r = N - 2; r > 0; --r){
+			uint32_t x = fillRow(reach[r] | reach[r + 1] | (reach[r + 1] << 1), rows[r]);
+			changed |= (x != reach[r]);
+			reach[r] = x;
 		}
+	} while (changed);
+
+	return 2;
+}
+
+// The player's stones of LANES boards, side by side, flood filled together: one hex step for all of them per
+// iteration, until none of them changes. Bit l of the result is set when the player has connected on board l.
+template<int N>
+unsigned Evaluate<N>::connectedLanes(const typename BoardSet<N>::Lanes& own, const int& playerNum){
+	const HexTopology<N>& t = hexTopology<N>;
+	auto reached = own & t.startBorder[playerNum];
+	typename BoardSet<N>::Lanes previous;
+	do{
+		previous = reached;
+		reached = reached | (t.spread(reached) & own);
+	} while (reached != previous);
+
+	return (reached & t.endBorder[playerNum]).nonzeroLanes();
+}
+
+// Writes the winner of each board of the set to results (0: No winner, 1: Player 1, 2: Player 2).
+// The boards are streamed LANES at a time. When every board of the set is full, one of the players has won each
+// of them, so only Player 1's connection is checked.
+template<int N>
+void Evaluate<N>::winnerBatch(const BoardSet<N>& boards, vector<int>& results){
+	int count = boards.size();
+	results.resize(count);
+	for (int first = 0; first < count; first += LANES){
+		int n = min(LANES, count - first);
+		unsigned won1 = connectedLanes(boards.lanes(1, first, n), 1);
+		unsigned won2 = boards.allFull() ? ~won1 : connectedLanes(boards.lanes(2, first, n), 2);
+		for (int l = 0; l < n; ++l)
+			results[first + l] = ((won1 >> l) & 1) ? 1 : ((won2 >> l) & 1) ? 2 : 0;
 	}
-	if (y < sizeofBoard - 1){
-		jNode = (x * sizeofBoard + y + 1); // Node j is to the right of Node i
-		(*g).set_edge_value(iNode, jNode, 1); // Set the edge from Node i to j
+}
+
+// Monte Carlo search tree, with all of its nodes in one pool. The children of a node are created together when the
+// node is expanded and stored next to each other, so a node only keeps the position of its first child and their count.
+template<int N>
+class SearchTree {
+	public:
+	using Index = typename HexTopology<N>::Index;
+	struct Node {
+		uint32_t visits = 0;		// Simulations that went through this node
+		uint32_t wins = 0;			// Simulations won by the player who made the move
+		uint32_t amafVisits = 0;	// Simulations through the parent in which player played move at some point (RAVE)
+		uint32_t amafWins = 0;		// Those of them won by player
+		int32_t firstChild = -1;	// Pool index of the first child, -1 while not expanded
+		uint16_t numChildren = 0;	// Number of children
+		Index move = 0;				// Cell played to reach this node
+		uint8_t player = 0;			// Player who played move
+	};
+	static constexpr int ROOT = 0;					// Pool index of the root
+	static constexpr size_t MAX_NODES = 1 << 21;	// Pool capacity; once it is full, leaves are no longer expanded
+
+	void reset(const int& lastPlayer);	// Leaves a single root, for a position in which lastPlayer moved last
+	void reroot(const int& i);			// Keeps only the subtree of node i, which becomes the root
+	int child(const int& i, const typename HexTopology<N>::Mask& moves) const;	// Child of node i whose move is in moves, or -1
+	Node& operator[](const int& i);		// Returns node i
+	const Node& operator[](const int& i) const;
+	int size() const;					// Returns the number of nodes
+	bool expand(const int& i, const Graph<N>& g, Xoshiro256& rng);	// Adds the children of node i, whose position is g
+
+	private:
+	vector<Node> pool;
+};
+
+template<int N>
+void SearchTree<N>::reset(const int& lastPlayer){
+	pool.clear();
+	pool.emplace_back();
+	pool[ROOT].player = lastPlayer;
+}
+
+// The subtree is copied breadth first into a new pool, so the children of each node stay next to each other
+template<int N>
+void SearchTree<N>::reroot(const int& i){
+	vector<Node> kept(1, pool[i]);
+	for (size_t k = 0; k < kept.size(); ++k){
+		int first = kept[k].firstChild;
+		if (first < 0)
+			continue;
+		kept[k].firstChild = static_cast<int32_t>(kept.size());
+		kept.insert(kept.end(), pool.begin() + first, pool.begin() + first + kept[k].numChildren);
 	}
-	if (x < sizeofBoard - 1){
-		jNode = ( (x + 1) * sizeofBoard + y ); // Node j is to the lower right of Node i
-		(*g).set_edge_value(iNode, jNode, 1); // Set the edge from Node i to j
+	pool.swap(kept);
+}
+
+template<int N>
+int SearchTree<N>::child(const int& i, const typename HexTopology<N>::Mask& moves) const{
+	for (int c = pool[i].firstChild; c >= 0 && c < pool[i].firstChild + pool[i].numChildren; ++c)
+		if (moves.test(pool[c].move))
+			return c;
+	return -1;
+}
+
+template<int N>
+typename SearchTree<N>::Node& SearchTree<N>::operator[](const int& i){
+	return pool[i];
+}
+
+template<int N>
+const typename SearchTree<N>::Node& SearchTree<N>::operator[](const int& i) const{
+	return pool[i];
+}
+
+template<int N>
+int SearchTree<N>::size() const{
+	return static_cast<int>(pool.size());
+}
+
+// One child per empty cell of g, in random order, so the selection tries unvisited children in random order.
+// Returns false, leaving node i a leaf, if the pool has no room for them.
+template<int N>
+bool SearchTree<N>::expand(const int& i, const Graph<N>& g, Xoshiro256& rng){
+	int count = g.emptyCount();
+	if (count == 0 || pool.size() + count > MAX_NODES)
+		return false;
+
+	int first = size();
+	int player = (pool[i].player * 2) % 3;	// The player to move at node i
+	pool.resize(pool.size() + count);
+	for (int k = 0; k < count; ++k){
+		pool[first + k].move = g.emptyCell(k);
+		pool[first + k].player = player;
 	}
+	for (int k = count - 1; k > 0; --k)	// Fisher-Yates shuffle
+		swap(pool[first + k].move, pool[first + rng.below(k + 1)].move);
+	pool[i].firstChild = first;
+	pool[i].numChildren = count;
+	return true;
+}
+
+// Class in charge of displaying board, determining AI's move, etc.
+template<int N>
+class hexGame{
+	public:
+	// State of one search thread: its own copy of the board, random stream and results
+	struct Worker {
+		Graph<N> board;			// Working copy; every candidate and simulation is played on it and then undone
+		Xoshiro256 rng;			// Random moves of this worker's simulations
+		long long playouts = 0;	// Number of simulations run
+		double bestProb = -1.0;	// Best win probability among this worker's candidates
+		int best = -1;			// Index of that candidate
+		int evaluated = 0;		// Candidates this worker has evaluated, one of which set bestProb
+		const vector<typename Graph<N>::Index>* fills = nullptr;	// Shared random fills in paired mode
+		int confidencePrunes = 0;	// Candidates stopped by the confidence bound
+		long long confidenceSkipped = 0;	// Simulations those candidates had left when they were stopped
+		int falsePrunes = 0;		// Audit: stopped candidates that would have beaten the best so far
+	};
+
+	static constexpr float UCT_C = 0.3f;		// Exploration constant of the tree search
+	static constexpr uint32_t EXPAND_VISITS = 2;	// Simulations through a leaf before it is expanded
+	static constexpr float RAVE_K = 500.0f;		// Visits at which RAVE statistics and real statistics weigh about the same
+	static constexpr int PRUNE_MINSIMS = 16;	// First check of the confidence bound; later checks come each time the simulations double
+
+	explicit hexGame(const SearchOptions& options = SearchOptions());
+	~hexGame();
+	Evaluate<N> game;	// Class object init, to evaluate game winner
+	SearchOptions options;	// Settings of the AI's search
+	Xoshiro256 rng;		// Candidate order, and the seeds of the workers' streams
+	vector<SearchTree<N> > trees;	// Tree search: one tree per worker
+	typename Graph<N>::Mask treeStones[2];	// Stones of players 1 and 2 in the position at the root of the trees
+	vector<Worker> ponderers;		// Pondering: the workers searching while the human thinks
+	vector<thread> ponderThreads;	// Their threads
+	atomic<bool> ponderStop{false};	// Tells them to stop
+	void drawBoard(const Graph<N>& g);
+	bool validMove(const Graph<N>& g, const string& command);
+	vector<pair <int, int> > availablePositions(const Graph<N>& g);
+	void aiMove(Graph<N>* g, const int& playerNum);	// Sets the best possible move returned from the mcs function
+	pair<int, int> monteCarloSims(const Graph<N>& g, const int& playerNum);	// mcs function responsible for determining AI's best move
+	vector<int> halvingRounds(const int& numCandidates) const;	// Simulations per candidate in each round of successive halving
+	int successiveHalving(vector<Worker>& workers, const vector<pair<int, int> >& candidates, const int& playerNum,
+		const vector<int>& rounds, vector<typename Graph<N>::Index>& fills);	// Returns the index of the candidate left after the rounds
+	void drawFills(const Graph<N>& g, const int& count, vector<typename Graph<N>::Index>& fills);	// Paired mode: count random fills of g's empty cells
+	pair<int, int> treeSearch(const Graph<N>& g, const int& playerNum);	// Tree search for the AI's best move
+	bool reuseTrees(const Graph<N>& g, const int& numWorkers);	// Re-roots the trees of the last search at g, if they lead to it
+	void grow(Worker& w, SearchTree<N>& tree, const long long& playouts, const atomic<bool>* stop = nullptr);	// Adds playouts simulations to the worker's tree, or fewer if stop is set
+	void ponder(const Graph<N>& g, const int& playerNum);	// Starts growing the trees at g, the human to move, in the background
+	void stopPondering();	// Stops the background search started by ponder, if any
+	int playout(Worker& w, const int& toMove, typename Graph<N>::Mask* finalStones = nullptr);	// Plays out w.board at random, toMove first, and returns the winner
+	void dealEmpty(Worker& w, const int& toMove, typename Graph<N>::Mask* stones);	// Deals the cells empty in stones[1..2] at random, toMove's share first
+	int winsMonteCarlo(Worker& w, const pair<int,int>& i, const double& bestProb, const int& playerNum, const int& numsim=SIMUL);	// Simulations of candidate i won by playerNum
+	bool unlikelyBest(const int& wins, const int& n, const double& bestProb, const int& numsim, const int& evaluated) const;	// Confidence bound test
+	bool playerMove(Graph<N>* g, string command, const int& playerNum);
+
+};
+
+template<int N>
+hexGame<N>::hexGame(const SearchOptions& options)
+	: options(options),
+	  rng(options.seeded ? options.seed : static_cast<uint64_t>(chrono::steady_clock::now().time_since_epoch().count())) {}
+
+template<int N>
+hexGame<N>::~hexGame(){
+	stopPondering();
 }
 
 // Draws game board
-void hexGame::drawBoard(const Graph& g){
+template<int N>
+void hexGame<N>::drawBoard(const Graph<N>& g){
 
 	// Prints NORTH label
 
-	cout << endl << setw(2 * sizeofBoard + 4) << "NORTH" << endl;
+	cout << endl << setw(2 * N + 4) << "NORTH" << endl;
 
 	// Prints Top Column Letters of Board
 
 	cout << endl << "  ";
-	for (int i = 0; i < sizeofBoard; i++)
+	for (int i = 0; i < N; i++)
 		cout << static_cast<char>(i + 'A') << "   ";
 	cout << endl << endl;
 
 	// Prints Left and Right Row Numbers of Board
 
-	for (int row = 0; row < sizeofBoard; row++){
+	for (int row = 0; row < N; row++){
 		if (row < 9){
 			for (int j = 0; j < (row * 2); j++)
 				cout << " " ;
@@ -383,20 +1155,20 @@ void hexGame::drawBoard(const Graph& g){
 				cout << " " ;
 		}
 		cout << row + 1 << "  "; // Print left row number
-		for (int col = 0; col < sizeofBoard; col++){
+		for (int col = 0; col < N; col++){
 			cout << g.get_sign(row, col);
-			if (col < sizeofBoard - 1)
+			if (col < N - 1)
 				// cout << "   ";
 				cout << " - ";
 		}
 		cout << "   " << row + 1; // Print right row number
-		if (row < sizeofBoard - 1){
+		if (row < N - 1){
 			cout << endl << "  ";
 			for (int j = 0; j < (row * 2) + 1; j++)
 				cout << " " ;
 			// cout << "  ";
 			cout << " \\";
-			for (int col = 0; col < sizeofBoard - 1; col++){
+			for (int col = 0; col < N - 1; col++){
 				// cout << "    ";
 				cout << " / \\";
 			}
@@ -407,23 +1179,23 @@ void hexGame::drawBoard(const Graph& g){
 
 	// Print Bottom Column Letters of Board
 
-	for (int row = 0; row < sizeofBoard * 2; row++)
+	for (int row = 0; row < N * 2; row++)
 		cout << " " ;
 	cout << "  ";
-	for (int i = 0; i < sizeofBoard; i++)
+	for (int i = 0; i < N; i++)
 		cout << static_cast<char>(i + 'A') << "   ";
 	cout << endl << endl;
 
 	// Prints SOUTH label
 
-	cout << setw(4 * (sizeofBoard) + 3) << "SOUTH" << endl << endl;
+	cout << setw(4 * (N) + 3) << "SOUTH" << endl << endl;
 
 }
 
 // Determines validity of human's move
-bool hexGame::validMove(const Graph& g, const string& command){
-	char maxNum = '0' + sizeofBoard;	// The max row number based on the size of the board chosen
-	char maxLetter = 'A' + sizeofBoard - 1;	// The max column letter based on the size of the board chosen
+template<int N>
+bool hexGame<N>::validMove(const Graph<N>& g, const string& command){
+	char maxLetter = 'A' + N - 1;	// The max column letter based on the size of the board chosen
 
 	// If user inputs -1, they have quit, exit program
 
@@ -432,35 +1204,24 @@ bool hexGame::validMove(const Graph& g, const string& command){
         exit(EXIT_SUCCESS);
     }
 
-	// If input length is more than 2 AND the board size < 10, invalid. Ex: board size 9, input 'A10' = invalid
-	// Or if the input row number surpasses the board size, invalid. Ex: board size 7, input 'A8' = invalid
-	// Or if the input col letter surpasses the board size, invalid. Ex: board size 3, input 'D2' = invalid
-
-	if (command.length() > 2 && sizeofBoard < 10 || (command[1] > maxNum) 
-	|| (command[0] > maxLetter) ){
-		cout << command << " is not a valid entry! Entry must be within a size of " << sizeofBoard << endl;
-		return false;
-	}
-
 	// If input length is less than 2 or greater than 3, invalid. Ex: input 'A' = invalid, input 'A100' = invalid
-	// Or if input col letter is not anything between A - K, invalid. Ex: board size 11, input 'L11' = invalid
+	// Or if input col letter is not a letter, invalid. Ex: input '1A' = invalid
+	// Or if the input row number is not a number, invalid. Ex: input 'AK' = invalid, input 'A1K' = invalid
+	// Or if the input row number starts with 0, invalid. Ex: input 'A0' = invalid, input 'A07' = invalid
 
-    if (command.length() < 2 || command.length() > 3 || command[0] < 'A' || command[0] > 'K' ){
+    if (command.length() < 2 || command.length() > 3 || command[0] < 'A' || command[0] > 'Z'
+	|| isdigit(command[1]) == 0 || (command.length() == 3 && isdigit(command[2]) == 0) || command[1] == '0'){
         cout << command << " is not a valid entry!" << endl;
         return false;
     }
 
-	// If the input row number is not a number, invalid. Ex: input 'AK' = invalid
-	// Or if the board size >= 10 AND the input row number of double digits is not a number, invalid. Ex: input 'A1K' = invalid
-	// Or if the board size >= 10 AND the input row number of double digits is > 11, invalid. Ex: board size 11, input 'A21' = invalid
-	// Or if the board size == 10 AND the input row number of double digits is > 10, invalid. Ex: board size 10, input 'A11' = invalid
+	// If the input row number surpasses the board size, invalid. Ex: board size 7, input 'A8' = invalid
+	// Or if the input col letter surpasses the board size, invalid. Ex: board size 3, input 'D2' = invalid
 
-    if ( (isdigit(command[1]) == 0) || (command.length() == 3 && isdigit(command[2]) == 0) 
-    || (command.length() == 3 && (command[1] > '1' || command[2] > '1') ) 
-	|| (sizeofBoard == 10 && command.length() == 3 && (command[1] > '1' || command[2] > '0')) ) {
-        cout << command << " is not a valid entry!" << endl;
-        return false;
-    }
+	if (stoi(command.substr(1)) > N || command[0] > maxLetter){
+		cout << command << " is not a valid entry! Entry must be within a size of " << N << endl;
+		return false;
+	}
     
 	auto [x, y] = coordinates(command);	// Convert string to x,y coordinate to check if the place is already occupied
 	
@@ -477,26 +1238,25 @@ bool hexGame::validMove(const Graph& g, const string& command){
 }
 
 // Returns vector of pair of coord for available positions on the board
-vector<pair <int, int> > hexGame::availablePositions(const Graph& g) const{
+template<int N>
+vector<pair <int, int> > hexGame<N>::availablePositions(const Graph<N>& g){
 	vector<pair <int,int> > availVect;	// vector holding positions that are not occupied by 'X' or 'O')
-	for (int i = 0; i < sizeofBoard; ++i){
-		for (int j = 0; j < sizeofBoard; ++j){
-			if (g.get_sign(i,j) == '.'){
-				availVect.push_back(make_pair(i,j));
-			}
-		}
+	availVect.reserve(g.emptyCount());
+	for (int k = 0; k < g.emptyCount(); ++k){
+		int cell = g.emptyCell(k);
+		availVect.push_back(make_pair(cell / N, cell % N));
 	}
 
-	unsigned int seed = chrono::steady_clock::now().time_since_epoch().count();
-	auto rng = default_random_engine{seed};
-	shuffle(availVect.begin(), availVect.end(), rng);
+	for (int k = static_cast<int>(availVect.size()) - 1; k > 0; --k)	// Fisher-Yates shuffle
+		swap(availVect[k], availVect[rng.below(k + 1)]);
 
 
 	return availVect;
 }
 
 // Function responsible for making a move decision for the AI
-void hexGame::aiMove(Graph* g, const int& playerNum){
+template<int N>
+void hexGame<N>::aiMove(Graph<N>* g, const int& playerNum){
 	char sign = 'X';
 
 	if ( playerNum == 1)
@@ -504,112 +1264,643 @@ void hexGame::aiMove(Graph* g, const int& playerNum){
 	else
 		sign = 'O';
 
-	auto [x,y] = monteCarloSims(*g, playerNum);
+	auto [x,y] = (options.search == TREE_SEARCH) ? treeSearch(*g, playerNum) : monteCarloSims(*g, playerNum);
 	cout << "AI, where would you like to place your move?: ";
 	cout << static_cast<char>(y + 'A');
 	cout << x + 1 << endl;
 
 	(*g).set_sign(x, y, sign);	// Set player's valid position as X/O on the board coord (x,y)
-	setEdges(x, y, g);	// Set edges for valid position	
 }
 
 // Function responsible for returning the best possible move for the AI based on the win prob for each possible move
-pair<int, int> hexGame::monteCarloSims(const Graph& g, const int& playerNum) {
-	pair<int,int> bestMove;
-	double bestprob = -1.0;
-	double probMC = 0.0;
-	double visited = 0.0;
-	double total = 0.0;
+template<int N>
+pair<int, int> hexGame<N>::monteCarloSims(const Graph<N>& g, const int& playerNum) {
 	vector<thread> threads;
-	
 
 	// cout << "Listing available positions" << endl;
 	cout << "Thinking..." << endl;
+	auto start = chrono::steady_clock::now();
 	vector< pair <int,int> > candidates = availablePositions(g);
-	total = static_cast<double>(candidates.size());	
-
-	for (auto i:candidates){
-		probMC = probMonteCarlo(g, i, bestprob, playerNum, SIMUL);	// For each candidate position, evaluate its Monte Carlo probability
-		// cout << "probMC = " << probMC << " for candidate " << i.first << ", " << i.second << endl;
-		if (bestprob < probMC){	// If its Monte Carlo probability is the best known, set this candidate as the best move
-			bestprob = probMC;
-			bestMove = i;
+	int numCandidates = static_cast<int>(candidates.size());
+	int numWorkers = max(1, min(options.threads, numCandidates));
+	vector<int> rounds;	// Successive halving: simulations per candidate in each round
+	if (options.schedule == SUCCESSIVE_HALVING)
+		rounds = halvingRounds(numCandidates);
+
+	// Paired mode: the fills of the ordered schedule are drawn here, those of successive halving at each round
+	vector<typename Graph<N>::Index> fills;
+	if (options.paired && options.schedule == ORDERED_PRUNING)
+		drawFills(g, options.simulations, fills);
+
+	// Each worker gets its own stream, one jump apart from the previous worker's, all seeded from rng
+	Xoshiro256 stream(rng());
+	vector<Worker> workers;
+	workers.reserve(numWorkers);
+	for (int t = 0; t < numWorkers; ++t){
+		workers.push_back(Worker{g, stream});
+		workers.back().fills = options.paired ? &fills : nullptr;
+		stream.jump();
+	}
+
+	int best;
+	if (options.schedule == SUCCESSIVE_HALVING)
+		best = successiveHalving(workers, candidates, playerNum, rounds, fills);
+	else{
+		// Worker t evaluates candidates t, t + numWorkers, t + 2 * numWorkers, ... and prunes against its own best,
+		// so the outcome depends on the seed and the number of workers, not on how the threads are scheduled
+		auto evaluate = [&](Worker& w, const int& t){
+			for (int c = t; c < numCandidates; c += numWorkers){
+				int wins = winsMonteCarlo(w, candidates[c], w.bestProb, playerNum, options.simulations);
+				double probMC = static_cast<double>(wins) / options.simulations;	// Monte Carlo probability of the candidate
+				if (w.bestProb < probMC){	// If its Monte Carlo probability is the best known, set this candidate as the best move
+					w.bestProb = probMC;
+					w.best = c;
+				}
+				w.evaluated++;
+			}
+		};
+		for (int t = 1; t < numWorkers; ++t)
+			threads.emplace_back(evaluate, ref(workers[t]), t);
+		evaluate(workers[0], 0);
+		for (auto& th : threads)
+			th.join();
+
+		// Best candidate over all workers, ties going to the candidate listed first
+		best = workers[0].best;
+		double bestprob = workers[0].bestProb;
+		for (const Worker& w : workers){
+			if (w.bestProb > bestprob || (w.bestProb == bestprob && w.best < best)){
+				bestprob = w.bestProb;
+				best = w.best;
+			}
+		}
+	}
+
+	long long playouts = 0;
+	for (const Worker& w : workers)
+		playouts += w.playouts;
+	double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+	cout << "Evaluated " << numCandidates << " moves with " << playouts << " simulations in "
+		 << fixed << setprecision(0) << ms << " ms (" << numWorkers << (numWorkers == 1 ? " thread" : " threads");
+	if (options.schedule == SUCCESSIVE_HALVING)
+		cout << ", " << rounds.size() << " halving rounds";
+	else if (options.pruning == CONFIDENCE_BOUND){
+		int prunes = 0;
+		int falsePrunes = 0;
+		long long skipped = 0;
+		for (const Worker& w : workers){
+			prunes += w.confidencePrunes;
+			falsePrunes += w.falsePrunes;
+			skipped += w.confidenceSkipped;
 		}
-		visited++;	// Update the visited moves counter
+		long long full = static_cast<long long>(options.simulations) * numCandidates;
+		cout << ", " << prunes << " stopped by confidence bound, " << setprecision(1) << 100.0 * skipped / full
+			 << "% of simulations skipped by these stops";
+		if (options.auditPruning)
+			cout << ", " << falsePrunes << " wrongly";
 	}
+	cout << ")" << endl;
 	// cout << "returning bestMove " << bestMove.first << ", " << bestMove.second << endl;
-	return bestMove;
+	return candidates[best];
 }
 
-// Function that executes the monte carlo simulations and evaluates the win prob for each move
-double hexGame::probMonteCarlo(Graph g, const pair<int,int>& i, const double& bestProb, const int& playerNum, const int &numsim) {
-	char sign = 'X';
-	char signH = 'O';
+// Successive halving over numCandidates candidates takes ceil(log2(numCandidates)) rounds. Each round gets an equal
+// share of the budget, split evenly over the candidates still in it, with at least one simulation each.
+template<int N>
+vector<int> hexGame<N>::halvingRounds(const int& numCandidates) const{
+	long long budget = options.playouts > 0 ? options.playouts : static_cast<long long>(options.simulations) * numCandidates;
+	int numRounds = 1;
+	while ((1 << numRounds) < numCandidates)
+		++numRounds;
+
+	vector<int> rounds;
+	for (int alive = numCandidates, r = 0; r < numRounds; ++r, alive = (alive + 1) / 2)
+		rounds.push_back(static_cast<int>(max(1LL, budget / (static_cast<long long>(alive) * numRounds))));
+	return rounds;
+}
+
+// Runs the rounds of successive halving. In each round the remaining candidates are shared out among the workers
+// as in the ordered schedule, every one of them gets the round's simulations without pruning, and the half with the
+// fewest wins is dropped, ties dropping the candidate listed last. In paired mode, the round's fills are drawn into
+// fills when it starts, so only one round's fills are held at a time.
+template<int N>
+int hexGame<N>::successiveHalving(vector<Worker>& workers, const vector<pair<int, int> >& candidates, const int& playerNum,
+	const vector<int>& rounds, vector<typename Graph<N>::Index>& fills) {
+	int numWorkers = static_cast<int>(workers.size());
+	vector<int> alive(candidates.size());	// Candidates still in the running
+	iota(alive.begin(), alive.end(), 0);
+	vector<long long> wins(candidates.size(), 0);	// Simulations won by each candidate so far
+
+	for (int numsim : rounds){
+		if (options.paired)
+			drawFills(workers[0].board, numsim, fills);
+		auto evaluate = [&](Worker& w, const int& t){
+			for (size_t k = t; k < alive.size(); k += numWorkers){
+				int c = alive[k];
+				wins[c] += winsMonteCarlo(w, candidates[c], -1.0, playerNum, numsim);
+			}
+		};
+		vector<thread> threads;
+		for (int t = 1; t < numWorkers; ++t)
+			threads.emplace_back(evaluate, ref(workers[t]), t);
+		evaluate(workers[0], 0);
+		for (auto& th : threads)
+			th.join();
+
+		sort(alive.begin(), alive.end(), [&](const int& a, const int& b){
+			return wins[a] > wins[b] || (wins[a] == wins[b] && a < b);
+		});
+		alive.resize((alive.size() + 1) / 2);
+	}
+	return alive[0];
+}
+
+// Paired mode: simulation j of every candidate follows fill j, a random order of the cells that are empty in g.
+// Candidates are then compared on the same random fills, so differences between them are not drowned in
+// the noise of independent samples, and fewer simulations tell them apart.
+template<int N>
+void hexGame<N>::drawFills(const Graph<N>& g, const int& count, vector<typename Graph<N>::Index>& fills){
+	int numEmpty = g.emptyCount();
+	fills.resize(static_cast<size_t>(count) * numEmpty);
+	for (int j = 0; j < count; ++j){
+		auto fill = fills.begin() + static_cast<size_t>(j) * numEmpty;
+		for (int k = 0; k < numEmpty; ++k)
+			fill[k] = g.emptyCell(k);
+		for (int k = numEmpty - 1; k > 0; --k)	// Fisher-Yates shuffle
+			swap(fill[k], fill[rng.below(k + 1)]);
+	}
+}
+
+// Function that executes the monte carlo simulations of a candidate move and returns how many of them playerNum won.
+// A candidate stopped early by pruning counts the wins of the simulations it ran.
+template<int N>
+int hexGame<N>::winsMonteCarlo(Worker& w, const pair<int,int>& i, const double& bestProb, const int& playerNum, const int &numsim) {
+	Graph<N>& g = w.board;	// Board of the worker, left as it was received
 	int winner = 0;	// To determine winner of round
 	int numwins = 0; // Holds number of wins for position
 	int total;	// Get the total number of available positions in the board
 	int goesNext;	// To determine which player goes next
-
-	Graph currentG; // Create a graph class object
-	vector< pair <int,int> > available, availablecopy;	// To determine available positions
-	vector< pair <int,int> >::iterator posptr;	// Position pointer for the avaialble positions
 	
-
-	if (playerNum == 1){
-		sign = 'X';
-		signH = 'O';
-	}
-	else{
-		sign = 'O';
-		signH = 'X';
-	}
-
 	auto[x,y] = i;	// Convert node i into (x,y) position on board
-	g.set_sign(x, y, sign);	// Set sign for valid position
-	setEdges(x, y, &g);	// Set edges for valid position
+	int candidate = g.node(x, y);
+	g.play(candidate, playerNum);	// Set sign for valid position, taken back before returning
 	
 	int winnerG = game.winnerAI(g, playerNum);	// Determine the winning state of the current position
 	winner = winnerG;	// Copy winner state
+	int available = g.emptyCount();	// Number of available positions in the board after the candidate
+	int other = (playerNum * 2) % 3;	// The opponent of playerNum
+	int own = (available + 2) / 2;		// In paired mode, cells of a fill that go to playerNum, the candidate included
+	int taken = (available + 1) / 2;	// Empty cells the opponent gets in a filled board, moving first
+	const auto& t = hexTopology<N>;
+	auto emptyMask = t.full ^ (g.get_stones(1) | g.get_stones(2));	// Cells left empty after the candidate
+
+	// With BATCH_FULL, full boards of the simulations wait here and are checked LANES at a time
+	BoardSet<N> pending;
+	vector<int> results;
+	auto countPending = [&](){
+		game.winnerBatch(pending, results);
+		numwins += count(results.begin(), results.end(), playerNum);
+		pending.clear();
+	};
+
+	// Confidence bound: wins when the candidate was stopped, or -1. With the audit, the simulations go on uncounted,
+	// and the random stream is put back afterwards so the audit doesn't change the search.
+	int prunedWins = -1;
+	bool confidence = options.pruning == CONFIDENCE_BOUND && bestProb >= 0.0;
+	int checkpoint = PRUNE_MINSIMS;	// Simulations at the next check of the confidence bound
+	Xoshiro256 prunedRng = w.rng;
 
 	int it = 0;	// Number of iterations of simulation is initially set to 0
-	while ( (it < numsim) && (( (numsim-it) + numwins) > (bestProb*numsim) )) {	// If this position can't beat bestprob, interrupt simulation
+	while ( (it < numsim) && (( (numsim-it) + numwins + pending.size()) > (bestProb*numsim) )) {	// If this position can't beat bestprob, interrupt simulation
+		if (confidence && it == checkpoint && pending.size() == 0){
+			checkpoint *= 2;
+			if (unlikelyBest(numwins, it, bestProb, numsim, w.evaluated)){
+				confidence = false;
+				prunedWins = numwins;
+				prunedRng = w.rng;
+				w.confidencePrunes++;
+				w.confidenceSkipped += numsim - it;
+				w.playouts += it;
+				if (!options.auditPruning)
+					break;
+			}
+		}
 		goesNext = playerNum; // AI goes first
 		goesNext = (goesNext * 2) % 3; // Alternates between 1 and 2, signifying each player respectively
-		currentG = g;	// Make a copy of graph g, to safely manipulate in the simulations to follow
-		available = availablePositions(g);	// Get a copy of all avalable positions in the board
-		total = available.size();			// Get the total number of available positions in the board
-		posptr = available.begin();	// Point to the first random move
+		total = available;
+
+		// Paired mode colors the fill instead of alternating: its first own cells go to playerNum and the rest to
+		// the opponent. If the candidate is among the opponent's cells, playerNum's last cell goes to the opponent
+		// in exchange, so each candidate still gets a uniformly random coloring of the other cells.
+		const typename Graph<N>::Index* fill = w.fills ? w.fills->data() + static_cast<size_t>(it) * (available + 1) : nullptr;
+		int q = available;		// Next position of the fill to play, walking from its end
+		bool traded = false;	// Whether the candidate was found among the opponent's cells of the fill
+
+		if (options.playout == RANDOM_COLORING && winner == 0){
+			// The opponent's cells of the filled board, sampled at once. In paired mode they are the fill's
+			// opponent cells, as described above.
+			typename Graph<N>::Mask theirs;
+			if (fill){
+				for (int p = own; p <= available; ++p){
+					if (fill[p] == candidate)
+						traded = true;
+					else
+						theirs.set(fill[p]);
+				}
+				if (traded)
+					theirs.set(fill[own - 1]);
+			}
+			else
+				theirs = randomSubset(emptyMask, available, taken, w.rng);
+			auto mine = g.get_stones(playerNum) | (emptyMask ^ theirs);
+			theirs = theirs | g.get_stones(other);
+			const auto& own1 = (playerNum == 1) ? mine : theirs;
+			if constexpr (Evaluate<N>::BATCH_FULL){
+				pending.add(own1, (playerNum == 1) ? theirs : mine);	// Winner is counted with the rest of the batch
+				winner = -1;
+			}
+			else
+				winner = game.winnerFull(own1);
+		}
 
 		while (winner == 0) {	// Play the game until there is a winner
-			auto[i,j] = *posptr;	// Set random moves coord to i,j
-			if (goesNext == playerNum){ // If AI's turn, set random coord i,j
-				currentG.set_sign(i, j, sign);
-				setEdges(i, j, &currentG);
+			int cell;
+			if (fill){
+				if (fill[q] == candidate){
+					traded = (q >= own);
+					--q;
+				}
+				cell = fill[q];
+				goesNext = (q >= own || (q == own - 1 && traded)) ? other : playerNum;
+				--q;
 			}
-			else{	// Else if human's turn, set random coord i,j
-				currentG.set_sign(i, j, signH);
-				setEdges(i, j, &currentG);
+			else{
+				// Pick a random empty cell. Playing it moves it out of the first total entries of the empty list,
+				// so the cells played in one simulation form a uniformly random fill order.
+				cell = g.emptyCell(w.rng.below(total));
 			}
+			g.play(cell, goesNext);	// Set random cell for the player whose turn it is
 			total--;	// Decrement total available positions
 			goesNext = (goesNext * 2) % 3;	// After a move has been made go on to next player move
-			if (total == 0){	// Once total available positions reaches 0, run algo to check for win
-				winner = game.winnerAI(currentG, playerNum);	// Check for winner
+			if (options.playout == EARLY_STOP){	// Connectivity is kept by the graph, so stop at the first connection
+				winner = g.get_winner();
+			}
+			else if (total == 0){	// Once total available positions reaches 0, run algo to check for win
+				if constexpr (Evaluate<N>::BATCH_FULL){
+					pending.add(g);	// Winner is counted with the rest of the batch
+					winner = -1;
+				}
+				else
+					winner = game.winnerFull(g);	// The board is full, so one connection check decides the winner
 			}
-			posptr++;	// Go to the next random position
 		}	// End of while
 
+		for (int k = total; k < available; ++k)	// Take back the moves of this simulation
+			g.undo();
+
 		if (winner == playerNum){	// If the winner is the function caller, increments the number of wins 
 			numwins++;
 		}
+		if (pending.size() == Evaluate<N>::LANES)
+			countPending();
 
 		winner = winnerG;	// Reset winner value eval to original initial move
 		++it;	// nth iteration is complete, increment it to continue next iterations
   	}
-	return (static_cast<double>(numwins)/static_cast<double>(numsim));	// Return win probability
+	if (pending.size() > 0)
+		countPending();
+	g.undo();	// Take back the candidate move, leaving g as it was received
+	if (prunedWins >= 0){	// Stopped by the confidence bound
+		if (numwins > bestProb * numsim)	// The audit finished it, and it beats the best so far
+			w.falsePrunes++;
+		numwins = prunedWins;
+		w.rng = prunedRng;
+	}
+	else
+		w.playouts += it;
+	return numwins;	// Return number of wins
+}
+
+// Whether a candidate with wins out of its first n simulations is unlikely to beat bestProb, the win rate over numsim
+// simulations of the best of the evaluated candidates so far. Hoeffding's inequality bounds a win rate over n
+// simulations within sqrt(ln(1 / p) / 2n) of its true value, except with probability p. pruneError is split in half:
+// - the candidate is checked at PRUNE_MINSIMS simulations and then each time they double, so its half is split evenly
+//   over those checks;
+// - bestProb is the highest of the evaluated candidates' win rates, so it is biased upwards. Its half is split evenly
+//   over all of them, so that the bottom of every one of their intervals, the best's included, holds at once.
+// By the union bound, a candidate better than the best so far is then stopped with probability at most pruneError,
+// when even the top of its interval is below the bottom of the best one's.
+template<int N>
+bool hexGame<N>::unlikelyBest(const int& wins, const int& n, const double& bestProb, const int& numsim, const int& evaluated) const{
+	int checks = 0;
+	for (int k = PRUNE_MINSIMS; k < numsim; k *= 2)
+		checks++;
+	if (checks == 0)
+		return false;
+	double radius = sqrt(log(2.0 * checks / options.pruneError) / (2.0 * n));
+	double bestRadius = sqrt(log(2.0 * max(1, evaluated) / options.pruneError) / (2.0 * numsim));
+	return static_cast<double>(wins) / n + radius < bestProb - bestRadius;
+}
+
+// Monte Carlo tree search. Each simulation walks down the tree from the root, at each node choosing the child with
+// the best upper confidence bound (UCT), expands the leaf it reaches once that leaf has been visited EXPAND_VISITS times,
+// plays the rest of the game at random, and adds the result to every node on its path.
+// With several workers, each grows its own tree from its own random stream (root parallelization) and the root
+// statistics of the trees are added up, so the outcome does not depend on how the threads are scheduled.
+template<int N>
+pair<int, int> hexGame<N>::treeSearch(const Graph<N>& g, const int& playerNum) {
+	vector<thread> threads;
+
+	cout << "Thinking..." << endl;
+	auto start = chrono::steady_clock::now();
+	int numCandidates = g.emptyCount();
+	long long budget = options.playouts > 0 ? options.playouts : static_cast<long long>(options.simulations) * numCandidates;
+	int numWorkers = static_cast<int>(max(1LL, min<long long>(options.threads, budget)));
+
+	Xoshiro256 stream(rng());
+	vector<Worker> workers;
+	workers.reserve(numWorkers);
+	bool reused = options.reuse && reuseTrees(g, numWorkers);
+	trees.resize(numWorkers);
+	long long reusedPlayouts = 0;	// Simulations of the last search kept in the trees
+	for (int t = 0; t < numWorkers; ++t){
+		workers.push_back(Worker{g, stream});
+		stream.jump();
+		if (reused)
+			reusedPlayouts += trees[t][SearchTree<N>::ROOT].visits;
+		else
+			trees[t].reset((playerNum * 2) % 3);
+	}
+	treeStones[0] = g.get_stones(1);
+	treeStones[1] = g.get_stones(2);
+	if (options.ponder)	// Simulations pondered on the reply count towards the budget, so the AI answers sooner
+		budget = max(budget - reusedPlayouts, static_cast<long long>(numCandidates));
+
+	for (int t = 1; t < numWorkers; ++t)
+		threads.emplace_back(&hexGame<N>::grow, this, ref(workers[t]), ref(trees[t]), budget / numWorkers, nullptr);
+	grow(workers[0], trees[0], budget / numWorkers + budget % numWorkers);
+	for (auto& th : threads)
+		th.join();
+
+	// Visits and wins of each move at the root, over all trees. The most visited move is played.
+	vector<uint32_t> visits(HexTopology<N>::CELLS, 0);
+	vector<double> wins(HexTopology<N>::CELLS, 0.0);
+	long long playouts = 0;
+	long long nodes = 0;
+	for (int t = 0; t < numWorkers; ++t){
+		const SearchTree<N>& tree = trees[t];
+		const auto& root = tree[SearchTree<N>::ROOT];
+		for (int c = root.firstChild; c >= 0 && c < root.firstChild + root.numChildren; ++c){
+			visits[tree[c].move] += tree[c].visits;
+			wins[tree[c].move] += tree[c].wins;
+		}
+		playouts += workers[t].playouts;
+		nodes += tree.size();
+	}
+	int best = g.emptyCell(0);
+	for (int cell = 0; cell < HexTopology<N>::CELLS; ++cell)
+		if (visits[cell] > visits[best] || (visits[cell] == visits[best] && wins[cell] > wins[best]))
+			best = cell;
+
+	double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+	cout << "Searched " << playouts << " simulations in " << fixed << setprecision(0) << ms << " ms ("
+		 << numWorkers << (numWorkers == 1 ? " thread, " : " threads, ") << nodes << " tree nodes, "
+		 << reusedPlayouts << " simulations reused), estimated win rate "
+		 << setprecision(3) << (visits[best] > 0 ? wins[best] / visits[best] : 0.0) << endl;
+	return {best / N, best % N};
+}
+
+// The trees of the last search are kept if g follows from their root position by moves the trees have nodes for,
+// normally the AI's move and the human's reply. Each tree is then cut down to the node of g, keeping the statistics
+// of the simulations that went through it. Returns false, leaving the trees to be reset, otherwise.
+template<int N>
+bool hexGame<N>::reuseTrees(const Graph<N>& g, const int& numWorkers){
+	if (static_cast<int>(trees.size()) != numWorkers)
+		return false;
+	typename Graph<N>::Mask added[2];	// Stones of each player played since the root position
+	for (int p = 0; p < 2; ++p){
+		const auto& stones = g.get_stones(p + 1);
+		if ((stones & treeStones[p]) != treeStones[p])	// A stone of the root position was taken back
+			return false;
+		added[p] = stones ^ treeStones[p];
+	}
+
+	vector<int> nodes(numWorkers);	// Node of g in each tree
+	for (int t = 0; t < numWorkers; ++t){
+		typename Graph<N>::Mask left[2] = {added[0], added[1]};
+		int i = SearchTree<N>::ROOT;
+		while (i >= 0 && (left[0].any() || left[1].any())){
+			int mover = (trees[t][i].player * 2) % 3;	// The player to move at node i
+			i = trees[t].child(i, left[mover - 1]);
+			if (i >= 0)
+				left[mover - 1].reset(trees[t][i].move);
+		}
+		if (i < 0)
+			return false;
+		nodes[t] = i;
+	}
+	for (int t = 0; t < numWorkers; ++t)
+		trees[t].reroot(nodes[t]);
+	return true;
+}
+
+// Pondering: while the human thinks, the trees are re-rooted at the position after the AI's move and grown on
+// options.threads background threads until the human's move arrives. The next search then keeps the subtree of the
+// reply that was played, as with the trees of a search.
+template<int N>
+void hexGame<N>::ponder(const Graph<N>& g, const int& playerNum){
+	if (!options.ponder || options.search != TREE_SEARCH || g.get_winner() != 0 || g.emptyCount() == 0)
+		return;
+	stopPondering();
+
+	int numWorkers = options.threads;
+	if (!reuseTrees(g, numWorkers)){
+		trees.resize(numWorkers);
+		for (auto& tree : trees)
+			tree.reset(playerNum);
+	}
+	treeStones[0] = g.get_stones(1);
+	treeStones[1] = g.get_stones(2);
+
+	Xoshiro256 stream(rng());
+	ponderers.reserve(numWorkers);
+	for (int t = 0; t < numWorkers; ++t){
+		ponderers.push_back(Worker{g, stream});
+		stream.jump();
+	}
+	ponderStop = false;
+	for (int t = 0; t < numWorkers; ++t)
+		ponderThreads.emplace_back(&hexGame<N>::grow, this, ref(ponderers[t]), ref(trees[t]), LLONG_MAX, &ponderStop);
+}
+
+template<int N>
+void hexGame<N>::stopPondering(){
+	if (ponderThreads.empty())
+		return;
+	ponderStop = true;
+	long long playouts = 0;
+	for (size_t t = 0; t < ponderThreads.size(); ++t){
+		ponderThreads[t].join();
+		playouts += ponderers[t].playouts;
+	}
+	ponderThreads.clear();
+	ponderers.clear();
+	cout << "Pondered " << playouts << " simulations while waiting" << endl;
+}
+
+// Runs playouts simulations of the tree search on the worker's board, which is left as it was received.
+// Stops early once stop, if given, is set.
+template<int N>
+void hexGame<N>::grow(Worker& w, SearchTree<N>& tree, const long long& playouts, const atomic<bool>* stop) {
+	Graph<N>& g = w.board;
+	vector<int> path;	// Nodes of the current simulation, from the root
+
+	for (long long it = 0; it < playouts && !(stop && stop->load(memory_order_relaxed)); ++it){
+		int i = SearchTree<N>::ROOT;
+		path.assign(1, i);
+		int winner = g.get_winner();
+
+		// Selection: descend through expanded nodes until the game is decided or a leaf is reached
+		while (winner == 0 && tree[i].numChildren > 0){
+			const auto& parent = tree[i];
+			float logVisits = log(static_cast<float>(parent.visits) + 1.0f);
+			int best = parent.firstChild;
+			float bestValue = -1.0f;
+			for (int c = parent.firstChild; c < parent.firstChild + parent.numChildren; ++c){
+				const auto& child = tree[c];
+				float value;
+				if (options.rave){
+					// Blend of the move's win rate and its all-moves-as-first win rate. The AMAF rate has many more
+					// samples but is biased, so its weight beta fades as the move's own visits grow. Moves without
+					// any statistics yet count as wins, which is all the exploration RAVE needs.
+					float amaf = child.amafVisits > 0 ? static_cast<float>(child.amafWins) / child.amafVisits : 1.0f;
+					float beta = sqrt(RAVE_K / (3.0f * child.visits + RAVE_K));
+					value = (1.0f - beta) * (child.visits > 0 ? static_cast<float>(child.wins) / child.visits : 0.0f) + beta * amaf;
+				}
+				else if (child.visits == 0){	// Unvisited children are tried first, in their random order
+					best = c;
+					break;
+				}
+				else
+					value = static_cast<float>(child.wins) / child.visits + UCT_C * sqrt(logVisits / child.visits);
+				if (value > bestValue){
+					bestValue = value;
+					best = c;
+				}
+			}
+			i = best;
+			g.play(tree[i].move, tree[i].player);
+			path.push_back(i);
+			winner = g.get_winner();
+		}
+
+		// Expansion: a leaf visited often enough gets its children, and the simulation continues through the first one
+		if (winner == 0 && tree[i].visits >= EXPAND_VISITS && tree.expand(i, g, w.rng)){
+			i = tree[i].firstChild;
+			g.play(tree[i].move, tree[i].player);
+			path.push_back(i);
+			winner = g.get_winner();
+		}
+
+		// Simulation and backup
+		typename Graph<N>::Mask finalStones[3];	// Stones of Player 1(1) and Player 2(2) at the end of the simulation
+		if (winner == 0)
+			winner = playout(w, (tree[i].player * 2) % 3, options.rave ? finalStones : nullptr);
+		else if (options.rave){	// The game ended inside the tree, with cells possibly still empty
+			finalStones[1] = g.get_stones(1);
+			finalStones[2] = g.get_stones(2);
+			if (g.emptyCount() > 0)
+				dealEmpty(w, (tree[i].player * 2) % 3, finalStones);
+		}
+		for (int n : path){
+			tree[n].visits++;
+			if (tree[n].player == winner)
+				tree[n].wins++;
+		}
+
+		// All moves as first: every child of a node on the path whose cell ended up with the child's player counts as
+		// if that move had been played at the node. The children are the cells empty at the node, so a stone there
+		// was placed later in the simulation.
+		if (options.rave){
+			for (int n : path){
+				const auto& node = tree[n];
+				for (int c = node.firstChild; c >= 0 && c < node.firstChild + node.numChildren; ++c){
+					auto& child = tree[c];
+					if (finalStones[child.player].test(child.move)){
+						child.amafVisits++;
+						if (child.player == winner)
+							child.amafWins++;
+					}
+				}
+			}
+		}
+		for (size_t k = 1; k < path.size(); ++k)	// Take back the moves of the tree part of the simulation
+			g.undo();
+		w.playouts++;
+	}
+}
+
+// Plays the position of the worker's board to the end at random, with toMove moving first, in the selected playout
+// mode, and returns the winner. If finalStones is given, finalStones[1] and finalStones[2] receive the stones of Player 1
+// and Player 2 at the end of the playout, with every cell owned even when the playout stopped early. The board is left
+// as it was received.
+template<int N>
+int hexGame<N>::playout(Worker& w, const int& toMove, typename Graph<N>::Mask* finalStones) {
+	Graph<N>& g = w.board;
+	int winner = g.get_winner();
+	int available = g.emptyCount();
+	if (winner == 0 && options.playout == RANDOM_COLORING){	// The mover's share of the empty cells, sampled at once
+		const auto& t = hexTopology<N>;
+		int other = (toMove * 2) % 3;
+		auto emptyMask = t.full ^ (g.get_stones(1) | g.get_stones(2));
+		auto mover = randomSubset(emptyMask, available, (available + 1) / 2, w.rng);
+		typename Graph<N>::Mask stones[3];
+		stones[toMove] = g.get_stones(toMove) | mover;
+		stones[other] = g.get_stones(other) | (emptyMask ^ mover);
+		if (finalStones){
+			finalStones[1] = stones[1];
+			finalStones[2] = stones[2];
+		}
+		return game.winnerFull(stones[1]);
+	}
+
+	int total = available;
+	int goesNext = toMove;
+	while (winner == 0){
+		g.play(g.emptyCell(w.rng.below(total)), goesNext);
+		total--;
+		goesNext = (goesNext * 2) % 3;
+		if (options.playout == EARLY_STOP)
+			winner = g.get_winner();
+		else if (total == 0)
+			winner = game.winnerFull(g);
+	}
+	if (finalStones){
+		finalStones[1] = g.get_stones(1);
+		finalStones[2] = g.get_stones(2);
+		if (total > 0)	// Stopped early: the cells left empty are dealt out as playing the game on would have
+			dealEmpty(w, goesNext, finalStones);
+	}
+	for (int k = total; k < available; ++k)
+		g.undo();
+	return winner;
+}
+
+// Completes the stones of a board that still has empty cells into a filled board: toMove receives half of the empty
+// cells, rounded up, chosen at random, and the opponent the rest, as if the game had been played on to the end.
+template<int N>
+void hexGame<N>::dealEmpty(Worker& w, const int& toMove, typename Graph<N>::Mask* stones){
+	int other = (toMove * 2) % 3;
+	auto emptyMask = hexTopology<N>.full ^ (stones[1] | stones[2]);
+	int available = emptyMask.count();
+	auto mover = randomSubset(emptyMask, available, (available + 1) / 2, w.rng);
+	stones[toMove] = stones[toMove] | mover;
+	stones[other] = stones[other] | (emptyMask ^ mover);
 }
 
 // Function handles player move, checks for validity, places move, etc.
-bool hexGame::playerMove(Graph* g, string command, const int& playerNum){
+template<int N>
+bool hexGame<N>::playerMove(Graph<N>* g, string command, const int& playerNum){
 	command[0] = toupper(command[0]); // Make any lowercase character uppercase (e.g. a1 -> A1)
 	char sign = 'X';
 	if ( playerNum == 1){
@@ -626,7 +1917,6 @@ bool hexGame::playerMove(Graph* g, string command, const int& playerNum){
 			auto [x, y] = coordinates(command); // e.g. converts string input A1 to ints (0,0) as x,y respectively
 
 			(*g).set_sign(x, y, sign);	// Set player's valid position as X/O on the board coord (x,y)
-			setEdges(x, y, g);	// Set edges for valid position
 			valid = true;
 			
         }
@@ -636,16 +1926,25 @@ bool hexGame::playerMove(Graph* g, string command, const int& playerNum){
 // Class responsible for handling game flow
 class Game {
   public:
+    explicit Game(const SearchOptions& options = SearchOptions()) : options(options) {}
     void start();
 
   private:
+    template<int N> void run();	// Game flow on an N x N board
+
+    // Dispatch table from board size to the game flow compiled for that size
+    template<int... S>
+    static constexpr array<void (Game::*)(), sizeof...(S)> runTable(integer_sequence<int, S...>){
+        return {&Game::run<S + MINBOARD>...};
+    }
+
+    SearchOptions options;		// Settings passed on to the AI
+    int sizeofBoard = 0;		// Side length of this game's board
     int moveCount = 0;
 	int movesAI = 0;
 	bool valid = -1;
 	char swap = 'y';			// User input for whether or not player wants to swap 'X' for 'O'
 	string command;				// User input for position of 'X' placed on board
-	Evaluate evaluate;			// Determine winner
-	hexGame hex;				// Constructure for hexGame class
 	int winner = 0;				// 0 : Nobody won, 2 : Player 2 won, 1: Player 1 won 
 	int player1 = 1;			// Value of 1: X, Value of -1: O
 	int player2 = 2;			// Value of 1: X, Value of -1: O
@@ -661,19 +1960,28 @@ void Game::start(){
 
 	cout << "-----------------------------------------------------------------------" << endl;
 	cout << "Welcome to the game of Hex. Enter -1 to quit game anytime." << endl;
-	cout << "What size board would you like to play with? Enter size (2 - 11): ";
+	cout << "What size board would you like to play with? Enter size (" << MINBOARD << " - " << MAXBOARD << "): ";
 	cin >> sizeofBoard;
 	cout << "-----------------------------------------------------------------------" << endl;
 
-	// Validate proper board size (between 2 - 11)
+	// Validate proper board size (between MINBOARD - MAXBOARD)
 
-	while (sizeofBoard < 2 || sizeofBoard > 11){
-		cout << endl << "Please enter a valid size of 7 or 11: ";
+	while (sizeofBoard < MINBOARD || sizeofBoard > MAXBOARD){
+		cout << endl << "Please enter a valid size between " << MINBOARD << " and " << MAXBOARD << ": ";
 		cin >> sizeofBoard;
 	}
 
-	// Initialize Graph g, representing the game board
-	Graph g(sizeofBoard * sizeofBoard + 4);	// n x n total nodes + 4 virtual nodes
+	// Continue with the game flow compiled for the chosen board size
+	static constexpr auto table = runTable(make_integer_sequence<int, MAXBOARD - MINBOARD + 1>());
+	(this->*table[sizeofBoard - MINBOARD])();
+}
+
+// Plays one game on an N x N board
+template<int N>
+void Game::run(){
+
+	hexGame<N> hex(options);	// Displays the board and decides the AI's moves
+	Graph<N> g;		// Initialize Graph g, representing the game board: n x n total nodes + 4 virtual nodes
 
 	if (moveCount == 0 && movesAI == 0){ // Draw game board + instructions if beginning of game
 			if (user == player2){
@@ -721,23 +2029,20 @@ void Game::start(){
 			
 			hex.aiMove(&g, computer); // Make a move decision for AI
 			++movesAI;	// Increment AI move count
-
-			if (movesAI >= sizeofBoard){ // If the move count = size of board or more, check for winner
-				winner = evaluate.winnerAI(g, computer);
-			}
+			winner = g.get_winner();	// Connectivity is kept up to date by the graph, so checking is a lookup
 
 		}
 
 		else{	// Else if Human turn, perform the following
 			cout << "Human, where would you like to place your move? (i.e. A1, B2, etc.): ";	// Ask user for input
+			hex.ponder(g, computer);	// With --ponder, the AI searches the human's replies meanwhile
 			cin >> command;	// Store user input as a string
+			hex.stopPondering();
 
 			valid = hex.playerMove(&g, command, user); // Returns true or false valid move
 			if (valid){	// If valid, increment player move count
 				moveCount++;
-				if (moveCount >= sizeofBoard){ // If valid moves reaches size of board, check for winner
-					winner = evaluate.winnerAI(g, user);
-				}
+				winner = g.get_winner();	// Check for winner after every valid move
 			}
 		}
 
@@ -763,11 +2068,173 @@ void Game::start(){
 
 }
 
+// Times the simulations of one candidate on an empty N x N board, once for each playout mode
+template<int N>
+void benchPlayouts(SearchOptions options, const int& numsim){
+	const pair<PlayoutMode, const char*> modes[] = {{FILL_BOARD, "fill"}, {EARLY_STOP, "early"}, {RANDOM_COLORING, "color"}};
+
+	for (auto [mode, name] : modes){
+		options.playout = mode;
+		hexGame<N> hex(options);
+		typename hexGame<N>::Worker w{Graph<N>(), hex.rng};
+		auto start = chrono::steady_clock::now();
+		double prob = static_cast<double>(hex.winsMonteCarlo(w, {N / 2, N / 2}, -1.0, 1, numsim)) / numsim;	// Center cell, never pruned
+		double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+		cout << setw(2) << N << "x" << setw(2) << left << N << right << "  " << setw(5) << left << name << right
+			 << setw(12) << fixed << setprecision(1) << numsim / ms << " playouts/ms"
+			 << "  (win rate " << setprecision(3) << prob << ")" << endl;
+	}
+}
+
+// Runs the playout benchmark for each board size in S
+template<int... S>
+void benchSizes(const SearchOptions& options, const int& numsim, integer_sequence<int, S...>){
+	(benchPlayouts<S>(options, numsim), ...);
+}
+
 // Main function
 
-int main(){
+int main(int argc, char* argv[]){
+
+	SearchOptions options;
+	bool bench = false;
+	string flatOption;	// Last option given that only flat Monte Carlo uses
+	string pruneOption;	// Last option given that only the ordered pruning of flat Monte Carlo uses
+	string treeOption;	// Last option given that only the tree search uses
+	string playoutsOption;	// --playouts, used by the tree search and successive halving only
+
+	// Options: --search=tree|flat selects tree search or flat Monte Carlo, --playouts=<n> sets the simulations per move
+	// of the tree search and successive halving, --playout=fill|early|color selects the simulation playout,
+	// --schedule=prune|halving selects how flat Monte Carlo spreads its simulations over the candidates, --seed=<n> makes the AI's searches reproducible,
+	// --threads=<n> sets the number of search threads, --sims=<n> the simulations per candidate move,
+	// --paired evaluates all candidates on the same random fills, --no-rave turns off the RAVE statistics of the tree search,
+	// --no-reuse starts every tree search from scratch instead of keeping the subtree of the position reached,
+	// --ponder keeps the tree search running while the human thinks,
+	// --prune=exact|confidence selects when ordered pruning stops a candidate, --prune-error=<p> sets the error rate of the
+	// confidence bound, --audit-prune counts its wrong stops, --bench times the playout modes and exits.
+	// --schedule, --paired and the --prune options apply to flat Monte Carlo only, and need --search=flat.
+	// The --prune options apply to the default schedule only, --playouts to the tree search and successive halving only,
+	// and --no-rave, --no-reuse and --ponder to the tree search only. Options that would have no effect are rejected.
+	// --ponder searches the subtree the next AI move starts from, so it can't be combined with --no-reuse.
+	for (int a = 1; a < argc; ++a){
+		string arg = argv[a];
+		bool valid = true;
+		try{
+			if (arg == "--search=tree")
+				options.search = TREE_SEARCH;
+			else if (arg == "--search=flat")
+				options.search = FLAT_MC;
+			else if (arg == "--playout=fill")
+				options.playout = FILL_BOARD;
+			else if (arg == "--playout=early")
+				options.playout = EARLY_STOP;
+			else if (arg == "--playout=color")
+				options.playout = RANDOM_COLORING;
+			else if (arg.rfind("--seed=", 0) == 0){
+				options.seed = stoull(arg.substr(7));
+				options.seeded = true;
+			}
+			else if (arg.rfind("--threads=", 0) == 0){
+				options.threads = stoi(arg.substr(10));
+				valid = options.threads >= 1;
+			}
+			else if (arg.rfind("--sims=", 0) == 0){
+				options.simulations = stoi(arg.substr(7));
+				valid = options.simulations >= 1;
+			}
+			else if (arg.rfind("--playouts=", 0) == 0){
+				options.playouts = stoll(arg.substr(11));
+				valid = options.playouts >= 1;
+				playoutsOption = arg;
+			}
+			else if (arg == "--schedule=prune"){
+				options.schedule = ORDERED_PRUNING;
+				flatOption = arg;
+			}
+			else if (arg == "--schedule=halving"){
+				options.schedule = SUCCESSIVE_HALVING;
+				flatOption = arg;
+			}
+			else if (arg == "--paired"){
+				options.paired = true;
+				flatOption = arg;
+			}
+			else if (arg == "--no-rave"){
+				options.rave = false;
+				treeOption = arg;
+			}
+			else if (arg == "--no-reuse"){
+				options.reuse = false;
+				treeOption = arg;
+			}
+			else if (arg == "--ponder"){
+				options.ponder = true;
+				treeOption = arg;
+			}
+			else if (arg == "--prune=exact"){
+				options.pruning = EXACT_BOUND;
+				pruneOption = arg;
+			}
+			else if (arg == "--prune=confidence"){
+				options.pruning = CONFIDENCE_BOUND;
+				pruneOption = arg;
+			}
+			else if (arg.rfind("--prune-error=", 0) == 0){
+				options.pruneError = stod(arg.substr(14));
+				valid = options.pruneError > 0.0 && options.pruneError < 1.0;
+				pruneOption = arg;
+			}
+			else if (arg == "--audit-prune"){
+				options.auditPruning = true;
+				pruneOption = arg;
+			}
+			else if (arg == "--bench")
+				bench = true;
+			else
+				valid = false;
+		}
+		catch (const logic_error&){	// Number that stoi, stoull or stod can't read
+			valid = false;
+		}
+		if (!valid){
+			cerr << "Usage: " << argv[0] << " [--search=tree|flat] [--playout=fill|early|color] [--schedule=prune|halving]\n"
+				 << "       [--seed=<n>] [--threads=<n>] [--sims=<n>] [--playouts=<n>] [--paired] [--no-rave] [--no-reuse]\n"
+				 << "       [--prune=exact|confidence] [--prune-error=<p>] [--audit-prune] [--ponder] [--bench]" << endl;
+			return 1;
+		}
+	}
+
+	if (!bench && options.search == TREE_SEARCH && !(flatOption + pruneOption).empty()){
+		cerr << (flatOption.empty() ? pruneOption : flatOption) << " applies to flat Monte Carlo only, add --search=flat to use it" << endl;
+		return 1;
+	}
+
+	if (!bench && options.search == FLAT_MC && !treeOption.empty()){
+		cerr << treeOption << " applies to the tree search only, it can't be combined with --search=flat" << endl;
+		return 1;
+	}
+
+	if (!bench && options.search == FLAT_MC && options.schedule == SUCCESSIVE_HALVING && !pruneOption.empty()){
+		cerr << pruneOption << " applies to the default schedule only, it can't be combined with --schedule=halving" << endl;
+		return 1;
+	}
+
+	if (!bench && options.search == FLAT_MC && options.schedule == ORDERED_PRUNING && !playoutsOption.empty()){
+		cerr << "--playouts applies to the tree search and --schedule=halving only, use --sims with the default schedule" << endl;
+		return 1;
+	}
+
+	if (options.ponder && !options.reuse){
+		cerr << "--ponder keeps the searched subtree for the next move, it can't be combined with --no-reuse" << endl;
+		return 1;
+	}
+
+	if (bench){
+		benchSizes(options, 20 * SIMUL, integer_sequence<int, 5, 7, 9, 11, 13, 15, 19, 25>());
+		return 0;
+	}
 
-	Game game;
+	Game game(options);
 	game.start();
 
 	return 0; // End of program.